@@ -0,0 +1,38 @@
+# Tries to find Zstandard.
+#
+# Usage of this module as follows:
+#
+#     find_package(Zstd)
+#
+# Variables used by this module, they can change the default behaviour and need
+# to be set before calling find_package:
+#
+#  ZSTD_ROOT_DIR  Set this variable to the root installation of
+#                 Zstandard if the module has problems finding
+#                 the proper installation path.
+#
+# Variables defined by this module:
+#
+#  ZSTD_FOUND              System has Zstandard libs/headers
+#  ZSTD_LIBRARIES          The Zstandard library
+#  ZSTD_INCLUDE_DIR        The location of Zstandard headers
+
+find_library(ZSTD_LIBRARIES
+  NAMES zstd
+  HINTS ${ZSTD_ROOT_DIR}/lib)
+
+find_path(ZSTD_INCLUDE_DIR
+  NAMES zstd.h
+  HINTS ${ZSTD_ROOT_DIR}/include)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(
+  ZSTD
+  DEFAULT_MSG
+  ZSTD_LIBRARIES
+  ZSTD_INCLUDE_DIR)
+
+mark_as_advanced(
+  ZSTD_ROOT_DIR
+  ZSTD_LIBRARIES
+  ZSTD_INCLUDE_DIR)
@@ -1,11 +1,155 @@
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include <caf/stream_deserializer.hpp>
+#include <caf/stream_serializer.hpp>
+#include <caf/streambuf.hpp>
+
 #include "vast/batch.hpp"
 #include "vast/detail/assert.hpp"
-#include "vast/detail/byte_swap.hpp"
+#include "vast/detail/column.hpp"
 #include "vast/detail/varbyte.hpp"
+#include "vast/detail/zigzag.hpp"
 #include "vast/error.hpp"
 #include "vast/event.hpp"
+#include "vast/expression.hpp"
+#include "vast/expression_visitors.hpp"
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/key.hpp"
 
 namespace vast {
+namespace {
+
+// The column holding the position of each event within the batch.
+constexpr size_t position_column = 0;
+
+// The column holding the timestamp of each event.
+constexpr size_t timestamp_column = 1;
+
+// The number of columns preceding the data columns.
+constexpr size_t meta_columns = 2;
+
+// Checks whether a record value has the structure of its type, i.e., whether
+// we can decompose it into one value per field.
+bool conforms(record_type const& t, data const& x) {
+  auto v = get_if<vector>(x);
+  if (!v || v->size() != t.fields.size())
+    return false;
+  for (auto i = 0u; i < t.fields.size(); ++i)
+    if (auto r = get_if<record_type>(t.fields[i].type))
+      if (!conforms(*r, (*v)[i]))
+        return false;
+  return true;
+}
+
+// Computes the number of columns of a record type.
+size_t leaves(record_type const& t) {
+  auto result = size_t{0};
+  for (auto& field : t.fields)
+    if (auto r = get_if<record_type>(field.type))
+      result += leaves(*r);
+    else
+      ++result;
+  return result;
+}
+
+// Appends the fields of a conforming record to one column each.
+void decompose(record_type const& t, vector const& v, vector* column) {
+  for (auto i = 0u; i < t.fields.size(); ++i)
+    if (auto r = get_if<record_type>(t.fields[i].type)) {
+      decompose(*r, get<vector>(v[i]), column);
+      column += leaves(*r);
+    } else {
+      column++->push_back(v[i]);
+    }
+}
+
+// Reassembles the record at a given row from its columns. The values get
+// moved out of mutable columns and copied out of const ones.
+template <class Column>
+vector compose(record_type const& t, Column* column, size_t row) {
+  vector result;
+  result.reserve(t.fields.size());
+  for (auto& field : t.fields)
+    if (auto r = get_if<record_type>(field.type)) {
+      result.push_back(compose(*r, column, row));
+      column += leaves(*r);
+    } else {
+      result.push_back(std::move((*column++)[row]));
+    }
+  return result;
+}
+
+template <class T>
+void write_varbyte(std::vector<char>& sink, T x) {
+  char buf[detail::varbyte::max_size<T>()];
+  auto n = detail::varbyte::encode(x, buf);
+  sink.insert(sink.end(), buf, buf + n);
+}
+
+// Computes the number of columns of a field type.
+size_t width(type const& t) {
+  auto r = get_if<record_type>(t);
+  return r ? leaves(*r) : 1;
+}
+
+// Computes the range of columns of the field at a given offset.
+std::pair<size_t, size_t> leaf_range(record_type const& t, offset const& o) {
+  VAST_ASSERT(t.at(o) != nullptr);
+  auto r = &t;
+  auto first = size_t{0};
+  for (auto i = 0u; i + 1 < o.size(); ++i) {
+    for (auto j = 0u; j < o[i]; ++j)
+      first += width(r->fields[j].type);
+    r = &get<record_type>(r->fields[o[i]].type);
+  }
+  for (auto j = 0u; j < o.back(); ++j)
+    first += width(r->fields[j].type);
+  return {first, first + width(r->fields[o.back()].type)};
+}
+
+// Writes a buffer as compressed section.
+void write_section(std::vector<char>& sink, std::vector<char> const& xs,
+                   compression method, dictionary const* dict = nullptr) {
+  std::vector<char> compressed;
+  compress(method, xs.data(), xs.size(), compressed, 0, dict);
+  write_varbyte(sink, static_cast<uint64_t>(xs.size()));
+  write_varbyte(sink, static_cast<uint64_t>(compressed.size()));
+  sink.insert(sink.end(), compressed.begin(), compressed.end());
+}
+
+// Reads and uncompresses a section.
+bool read_section(char const*& ptr, char const* end, compression method,
+                  std::vector<char>& xs, dictionary const* dict = nullptr) {
+  uint64_t uncompressed_size, compressed_size;
+  if (!detail::varbyte::decode(uncompressed_size, ptr, end)
+      || !detail::varbyte::decode(compressed_size, ptr, end)
+      || compressed_size > static_cast<uint64_t>(end - ptr))
+    return false;
+  xs.resize(uncompressed_size);
+  if (uncompressed_size > 0) {
+    auto n = uncompress(method, ptr, compressed_size, xs.data(), xs.size(),
+                        dict);
+    if (n != uncompressed_size)
+      return false;
+  }
+  ptr += compressed_size;
+  return true;
+}
+
+// Skips a section without uncompressing it.
+bool skip_section(char const*& ptr, char const* end) {
+  uint64_t uncompressed_size, compressed_size;
+  if (!detail::varbyte::decode(uncompressed_size, ptr, end)
+      || !detail::varbyte::decode(compressed_size, ptr, end)
+      || compressed_size > static_cast<uint64_t>(end - ptr))
+    return false;
+  ptr += compressed_size;
+  return true;
+}
+
+} // namespace <anonymous>
 
 bool batch::ids(event_id begin, event_id end) {
   if (end - begin != events())
@@ -28,147 +172,804 @@ const bitmap& batch::ids() const {
   return ids_;
 }
 
+std::pair<event_id, event_id> batch::id_range() const {
+  if (ids_.empty())
+    return {invalid_event_id, invalid_event_id};
+  auto n = rank(ids_);
+  if (n == 0)
+    return {invalid_event_id, invalid_event_id};
+  return {select(ids_, 1), select(ids_, n)};
+}
+
 batch::size_type batch::events() const {
-  return events_;
+  return read_header().events;
+}
+
+timestamp batch::first() const {
+  return read_header().first;
+}
+
+timestamp batch::last() const {
+  return read_header().last;
+}
+
+expected<batch> batch::view(char const* bytes, size_t size,
+                            std::shared_ptr<void const> owner) {
+  header h;
+  auto ptr = bytes;
+  if (size > 0 && !read_header(ptr, bytes + size, h))
+    return fail<ec::parse_error>("malformed batch header");
+  batch result;
+  result.view_ = bytes;
+  result.view_size_ = size;
+  result.owner_ = std::move(owner);
+  return result;
+}
+
+bool batch::read_header(char const*& ptr, char const* end, header& h) {
+  if (ptr == end)
+    return false;
+  h.method = static_cast<compression>(*ptr++);
+  uint64_t first, last;
+  if (!detail::varbyte::decode(h.events, ptr, end)
+      || !detail::varbyte::decode(first, ptr, end)
+      || !detail::varbyte::decode(last, ptr, end))
+    return false;
+  h.first = timestamp{interval{detail::zigzag::decode(first)}};
+  h.last = timestamp{interval{detail::zigzag::decode(last)}};
+  return true;
+}
+
+batch::header batch::read_header() const {
+  header h;
+  auto ptr = bytes();
+  if (size() > 0 && !read_header(ptr, ptr + size(), h))
+    return header{};
+  return h;
+}
+
+char const* batch::bytes() const {
+  return view_ ? view_ : data_.data();
+}
+
+size_t batch::size() const {
+  return view_ ? view_size_ : data_.size();
 }
 
-batch::writer::writer(compression method)
-  : vectorbuf_{batch_.data_},
-    compressedbuf_{vectorbuf_, method},
-    serializer_{compressedbuf_} {
-  batch_.method_ = method;
+void batch::own() {
+  if (view_ == nullptr)
+    return;
+  data_.assign(view_, view_ + view_size_);
+  view_ = nullptr;
+  view_size_ = 0;
+  owner_.reset();
+}
+
+batch::writer::writer(compression method, size_t block_size,
+                      dictionary_map const* dictionaries,
+                      type_registry* registry)
+  : block_size_{block_size},
+    dictionaries_{dictionaries},
+    registry_{registry} {
+  VAST_ASSERT(block_size > 0);
+  header_.method = method;
 }
 
 bool batch::writer::write(event const& e) {
   // Write meta data.
-  if (e.timestamp() < batch_.first_)
-    batch_.first_ = e.timestamp();
-  if (e.timestamp() > batch_.last_)
-    batch_.last_ = e.timestamp();
-  // Write type.
-  auto t = type_cache_.find(e.type());
-  if (t == type_cache_.end()) {
-    auto type_id = static_cast<uint32_t>(type_cache_.size());
-    t = type_cache_.emplace(e.type(), type_id).first;
-    serializer_ << t->second << e.type();
-  } else {
-    serializer_ << t->second;
-  }
-  serializer_ << e.timestamp() << e.data();
-  ++batch_.events_;
+  if (e.timestamp() < header_.first)
+    header_.first = e.timestamp();
+  if (e.timestamp() > header_.last)
+    header_.last = e.timestamp();
+  // Records that have the structure of their type get one column per field,
+  // all other values end up in a single column.
+  auto r = get_if<record_type>(e.type());
+  auto columnar = r && conforms(*r, e.data());
+  auto& t = get_table(e.type(), columnar);
+  t.columns[position_column].push_back(header_.events);
+  t.columns[timestamp_column].push_back(e.timestamp());
+  if (columnar)
+    decompose(*r, get<vector>(e.data()), &t.columns[meta_columns]);
+  else
+    t.columns[meta_columns].push_back(e.data());
+  ++header_.events;
+  if (header_.events % block_size_ == 0)
+    flush();
   return true;
 }
 
 batch batch::writer::seal() {
-  auto n = compressedbuf_.pubsync();
-  VAST_ASSERT(n >= 0);
+  flush();
+  auto& buf = batch_.data_;
+  buf.push_back(static_cast<char>(header_.method));
+  write_varbyte(buf, header_.events);
+  auto first = header_.first.time_since_epoch().count();
+  auto last = header_.last.time_since_epoch().count();
+  write_varbyte(buf, detail::zigzag::encode(first));
+  write_varbyte(buf, detail::zigzag::encode(last));
+  write_varbyte(buf, static_cast<uint64_t>(blocks_.size()));
+  for (auto& blk : blocks_) {
+    write_varbyte(buf, blk.first);
+    write_varbyte(buf, blk.second);
+  }
+  buf.insert(buf.end(), block_data_.begin(), block_data_.end());
   auto result = std::move(batch_);
   // Prepare for the next batch.
   batch_ = batch{};
-  batch_.method_ = result.method_;
-  vectorbuf_ = caf::vectorbuf{batch_.data_};
+  header_ = header{header_.method};
+  blocks_.clear();
+  block_data_.clear();
   return result;
 }
 
-batch::reader::reader(batch const& b)
-  : data_{b.data_},
-    id_range_{bit_range(b.ids_)},
-    available_{b.events()},
-    charbuf_{const_cast<char*>(data_.data()), data_.size()},
-    compressedbuf_{charbuf_},
-    deserializer_{compressedbuf_} {
+batch::writer::table& batch::writer::get_table(type const& t, bool columnar) {
+  // Consecutive events usually share the representation of their type, which
+  // we can check without hashing.
+  for (auto& table : tables_)
+    if (table.columnar == columnar && identical(table.event_type, t))
+      return table;
+  auto& tables = columnar ? record_tables_ : value_tables_;
+  auto i = tables.find(t);
+  if (i != tables.end())
+    return tables_[i->second];
+  tables.emplace(t, tables_.size());
+  auto columns = columnar ? leaves(get<record_type>(t)) : 1;
+  tables_.push_back({t, columnar, std::vector<vector>(meta_columns + columns)});
+  return tables_.back();
+}
+
+void batch::writer::flush() {
+  if (tables_.empty())
+    return;
+  auto first = tables_.front().columns[position_column].front();
+  auto offset = block_data_.size();
+  write_varbyte(block_data_, static_cast<uint64_t>(tables_.size()));
+  std::vector<char> raw;
+  for (auto& t : tables_) {
+    auto dict = static_cast<dictionary const*>(nullptr);
+    if (dictionaries_ != nullptr && supports_dictionary(header_.method)) {
+      auto i = dictionaries_->find(t.event_type);
+      if (i != dictionaries_->end())
+        dict = &i->second;
+    }
+    auto has_dictionary = dict != nullptr;
+    raw.clear();
+    caf::vectorbuf vectorbuf{raw};
+    caf::stream_serializer<caf::vectorbuf&> serializer{vectorbuf};
+    auto registered = registry_ != nullptr;
+    serializer << registered;
+    if (registered)
+      serializer << registry_->add(t.event_type);
+    else
+      serializer << t.event_type;
+    serializer << t.columnar << has_dictionary;
+    write_section(block_data_, raw, header_.method);
+    write_varbyte(block_data_, static_cast<uint64_t>(t.columns.size()));
+    for (auto& column : t.columns) {
+      raw.clear();
+      detail::encode_column(column, raw);
+      write_section(block_data_, raw, header_.method, dict);
+    }
+  }
+  blocks_.emplace_back(get<count>(first), block_data_.size() - offset);
+  tables_.clear();
+  record_tables_.clear();
+  value_tables_.clear();
+}
+
+batch::reader::reader(batch const& b, dictionary_map const* dictionaries,
+                      type_registry::snapshot_type types)
+  : batch_{b},
+    dictionaries_{dictionaries},
+    types_{std::move(types)} {
 }
 
 expected<std::vector<event>> batch::reader::read() {
+  if (auto err = parse())
+    return err;
   auto result = std::vector<event>{};
-  result.reserve(available_);
-  while (available_ > 0)
-    if (auto e = materialize())
-      result.push_back(std::move(*e));
-    else
-      return e.error();
+  result.reserve(batch_.events());
+  for (auto& blk : blocks_) {
+    if (auto err = decode(blk))
+      return err;
+    auto& xs = block_events_;
+    result.insert(result.end(), std::make_move_iterator(xs.begin()),
+                  std::make_move_iterator(xs.end()));
+  }
+  // Assign event IDs.
+  auto ids = select(batch_.ids_);
+  for (auto& e : result) {
+    if (ids.done())
+      break;
+    e.id(ids.get());
+    ids.next();
+  }
   return result;
 }
 
 expected<std::vector<event>> batch::reader::read(const bitmap& ids) {
-  using word = typename bitmap::word_type;
   auto result = std::vector<event>{};
-  if (id_range_.done())
-    return result;
-  auto e = expected<event>{fail()};
-  auto n = event_id{0};
-  auto rng = bit_range(ids);
-  auto begin = rng.begin();
-  auto end = rng.end();
-  auto next = [&](auto bits, auto id) {
-    auto i = bits.find_next(id - n);
-    if (i != word::npos)
-      i += n;
-    return i;
-  };
-  for ( ; begin != end; n += begin->size(), ++begin) {
-    auto& bits = *begin;
-    auto first = bits.find_first();
-    if (first == word::npos)
-      continue;
-    auto id = n + first;
-    // If a previously materialized event is ahead, we must catch up first.
-    if (e && id < e->id()) {
-      id = next(bits, e->id() - 1);
-      if (id == e->id()) {
-        result.push_back(std::move(*e));
-        e = fail();
-        id = next(bits, id);
+  if (auto err = read(ids, result))
+    return err;
+  return result;
+}
+
+error batch::reader::read(const bitmap& ids, std::vector<event>& xs) {
+  fields_ = nullptr;
+  return extract(ids, xs);
+}
+
+expected<std::vector<event>>
+batch::reader::read(const bitmap& ids, std::vector<offset> const& fields) {
+  fields_ = &fields;
+  projections_.clear();
+  auto result = std::vector<event>{};
+  auto err = extract(ids, result);
+  fields_ = nullptr;
+  if (err)
+    return err;
+  return result;
+}
+
+template <class Decode, class F>
+error batch::reader::locate(const bitmap& ids, Decode decode, F f) {
+  auto wanted = ids & batch_.ids_;
+  auto hits = select(wanted);
+  if (hits.done())
+    return {};
+  if (auto err = parse())
+    return err;
+  // Map each requested ID to its position in the batch and decode only the
+  // blocks containing these positions.
+  auto all = select(batch_.ids_);
+  auto pos = size_type{0};
+  auto blk = blocks_.begin();
+  auto decoded = blocks_.end();
+  for ( ; !hits.done(); hits.next()) {
+    for ( ; all.get() != hits.get(); all.next())
+      ++pos;
+    while (blk != blocks_.end() && pos >= blk->first + blk->events)
+      ++blk;
+    if (blk == blocks_.end())
+      return fail<ec::parse_error>("batch lacks event at position", pos);
+    if (blk != decoded) {
+      if (auto err = decode(*blk))
+        return err;
+      decoded = blk;
+    }
+    if (auto err = f(pos - blk->first, hits.get()))
+      return err;
+  }
+  return {};
+}
+
+error batch::reader::extract(const bitmap& ids, std::vector<event>& result) {
+  auto decode_events = [&](block const& blk) { return decode(blk); };
+  return locate(ids, decode_events, [&](size_t pos, event_id id) -> error {
+    auto& e = block_events_[pos];
+    if (!fields_ || is<record_type>(e.type())) {
+      e.id(id);
+      result.push_back(std::move(e));
+    }
+    // Otherwise the event type lacks a selected field.
+    return {};
+  });
+}
+
+error batch::reader::each(const bitmap& ids,
+                          std::function<void(event_view const&)> f) {
+  fields_ = nullptr;
+  auto decode = [&](block const& blk) { return decode_views(blk); };
+  return locate(ids, decode, [&](size_t pos, event_id id) -> error {
+    auto& row = view_rows_[pos];
+    if (row.first >= view_tables_.size())
+      return fail<ec::parse_error>("batch lacks event at position", pos);
+    f(event_view{id, view_tables_[row.first], row.second});
+    return {};
+  });
+}
+
+batch::reader::event_view::event_view(event_id id, view_table const& t,
+                                      size_t row)
+  : id_{id},
+    table_{&t},
+    row_{row} {
+}
+
+event_id batch::reader::event_view::id() const {
+  return id_;
+}
+
+timestamp batch::reader::event_view::timestamp() const {
+  return get<vast::timestamp>(table_->columns[timestamp_column][row_]);
+}
+
+type const& batch::reader::event_view::event_type() const {
+  return table_->raw.event_type;
+}
+
+size_t batch::reader::event_view::size() const {
+  return table_->columns.size() - meta_columns;
+}
+
+data_view const& batch::reader::event_view::operator[](size_t i) const {
+  VAST_ASSERT(i < size());
+  return table_->columns[meta_columns + i][row_];
+}
+
+event batch::reader::event_view::materialize() const {
+  auto x = data{};
+  if (table_->raw.columnar) {
+    // Reassemble the record from single-row columns.
+    std::vector<vector> columns(size());
+    for (auto i = 0u; i < size(); ++i)
+      columns[i].push_back(vast::materialize((*this)[i]));
+    x = compose(get<record_type>(event_type()), columns.data(), 0);
+  } else {
+    x = vast::materialize((*this)[0]);
+  }
+  auto result = event{{std::move(x), event_type()}};
+  result.id(id_);
+  result.timestamp(timestamp());
+  return result;
+}
+
+error batch::reader::parse() {
+  auto malformed = [] { return fail<ec::parse_error>("malformed batch"); };
+  blocks_.clear();
+  auto ptr = batch_.bytes();
+  auto end = ptr + batch_.size();
+  if (ptr == end)
+    return {};
+  header h;
+  uint64_t num_blocks;
+  if (!batch::read_header(ptr, end, h)
+      || !detail::varbyte::decode(num_blocks, ptr, end))
+    return malformed();
+  method_ = h.method;
+  auto events = h.events;
+  for (auto i = 0u; i < num_blocks; ++i) {
+    uint64_t first, size;
+    if (!detail::varbyte::decode(first, ptr, end)
+        || !detail::varbyte::decode(size, ptr, end))
+      return malformed();
+    if (first > events || (!blocks_.empty() && first < blocks_.back().first))
+      return malformed();
+    if (!blocks_.empty())
+      blocks_.back().events = first - blocks_.back().first;
+    blocks_.push_back({first, events - first, nullptr, size});
+  }
+  // The block data follows the block table.
+  for (auto& blk : blocks_) {
+    if (blk.size > static_cast<size_t>(end - ptr))
+      return malformed();
+    blk.data = ptr;
+    ptr += blk.size;
+  }
+  return {};
+}
+
+error batch::reader::decode(block const& blk) {
+  auto malformed = [] { return fail<ec::parse_error>("malformed batch"); };
+  auto ptr = blk.data;
+  auto end = blk.data + blk.size;
+  uint64_t tables;
+  if (!detail::varbyte::decode(tables, ptr, end))
+    return malformed();
+  auto& xs = block_events_;
+  xs.clear();
+  xs.resize(blk.events);
+  auto& t = table_;
+  auto& columns = table_columns_;
+  for (auto i = 0u; i < tables; ++i) {
+    if (auto err = read_table(ptr, end, t))
+      return err;
+    if (t.proj && !is<record_type>(t.proj->projected))
+      continue; // The event type lacks a selected field.
+    columns.resize(t.columns.size());
+    for (auto c = 0u; c < t.columns.size(); ++c) {
+      if (t.proj && t.columnar && !t.proj->columns[c]) {
+        columns[c].clear();
+        continue;
       }
+      auto& raw = t.columns[c];
+      auto err = detail::decode_column(raw.data(), raw.data() + raw.size(),
+                                       columns[c], blk.events);
+      if (err)
+        return err;
+      if (c > 0 && columns[c].size() != columns.front().size())
+        return malformed();
     }
-    while (id != word::npos) {
-      // Materialize events until have the one we want.
-      do {
-        e = materialize();
-        if (!e)
-          return e.error();
-        VAST_ASSERT(e->id() != invalid_event_id);
-      } while (id > e->id());
-      // If the materialized event is ahead, see if the current bit sequence
-      // has the event ID.
-      if (id < e->id())
-        id = next(bits, e->id() - 1);
-      // If we have materialized the event we want, add it to the result.
-      if (id == e->id()) {
-        result.push_back(std::move(*e));
-        e = fail();
-        id = next(bits, id);
+    // Materialize the events at their position in the block.
+    auto& positions = columns[position_column];
+    auto& timestamps = columns[timestamp_column];
+    for (auto row = 0u; row < positions.size(); ++row) {
+      auto pos = get_if<count>(positions[row]);
+      auto ts = get_if<timestamp>(timestamps[row]);
+      if (!pos || *pos < blk.first || *pos - blk.first >= xs.size() || !ts)
+        return malformed();
+      auto& e = xs[*pos - blk.first];
+      if (t.proj) {
+        auto& fields = get<record_type>(t.proj->projected).fields;
+        vector x;
+        x.reserve(fields.size());
+        for (auto i = 0u; i < fields.size(); ++i) {
+          if (!t.columnar) {
+            auto y = get(columns[meta_columns][row], (*fields_)[i]);
+            x.push_back(y ? *y : data{});
+          } else if (auto r = get_if<record_type>(fields[i].type)) {
+            // Selected fields may overlap, so we copy the values.
+            auto first = &columns[meta_columns + t.proj->leaves[i].first];
+            x.push_back(compose(*r, static_cast<vector const*>(first), row));
+          } else {
+            x.push_back(columns[meta_columns + t.proj->leaves[i].first][row]);
+          }
+        }
+        e = event{{std::move(x), t.proj->projected}};
+      } else {
+        auto x = t.columnar
+          ? data{compose(get<record_type>(t.event_type),
+                         &columns[meta_columns], row)}
+          : std::move(columns[meta_columns][row]);
+        e = event{{std::move(x), t.event_type}};
       }
+      e.timestamp(*ts);
     }
   }
+  return {};
+}
+
+error batch::reader::decode_views(block const& blk) {
+  auto malformed = [] { return fail<ec::parse_error>("malformed batch"); };
+  auto ptr = blk.data;
+  auto end = blk.data + blk.size;
+  uint64_t tables;
+  if (!detail::varbyte::decode(tables, ptr, end))
+    return malformed();
+  // Positions without an event refer to a table that does not exist.
+  auto& rows = view_rows_;
+  rows.assign(blk.events, {std::numeric_limits<size_t>::max(), 0});
+  for (auto i = 0u; i < tables; ++i) {
+    if (i == view_tables_.size())
+      view_tables_.emplace_back();
+    auto& t = view_tables_[i];
+    if (auto err = read_table(ptr, end, t.raw))
+      return err;
+    t.columns.resize(t.raw.columns.size());
+    for (auto c = 0u; c < t.columns.size(); ++c) {
+      auto& raw = t.raw.columns[c];
+      auto x = detail::column_view::make(raw.data(), raw.data() + raw.size(),
+                                         blk.events);
+      if (!x)
+        return x.error();
+      if (c > 0 && x->size() != t.columns.front().size())
+        return malformed();
+      t.columns[c] = std::move(*x);
+    }
+    auto& positions = t.columns[position_column];
+    auto& timestamps = t.columns[timestamp_column];
+    for (auto row = 0u; row < positions.size(); ++row) {
+      auto pos = get_if<count>(positions[row]);
+      if (!pos || *pos < blk.first || *pos - blk.first >= rows.size()
+          || !is<timestamp>(timestamps[row]))
+        return malformed();
+      rows[*pos - blk.first] = {i, row};
+    }
+  }
+  return {};
+}
+
+error batch::reader::read_table(char const*& ptr, char const* end,
+                                table& t) {
+  auto malformed = [] { return fail<ec::parse_error>("malformed batch"); };
+  // Read the table header.
+  auto& raw = table_header_;
+  bool registered;
+  bool has_dictionary;
+  if (!read_section(ptr, end, method_, raw))
+    return malformed();
+  caf::charbuf charbuf{raw.data(), raw.size()};
+  caf::stream_deserializer<caf::charbuf&> deserializer{charbuf};
+  deserializer >> registered;
+  if (registered) {
+    type_registry::id_type id;
+    deserializer >> id;
+    auto x = type_registry::lookup(types_, id);
+    if (!x)
+      return fail("no registered type with ID", id);
+    t.event_type = *x;
+  } else {
+    deserializer >> t.event_type;
+  }
+  deserializer >> t.columnar >> has_dictionary;
+  auto dict = static_cast<dictionary const*>(nullptr);
+  if (has_dictionary) {
+    if (dictionaries_ == nullptr)
+      return fail("no dictionary for type", t.event_type.name());
+    auto i = dictionaries_->find(t.event_type);
+    if (i == dictionaries_->end())
+      return fail("no dictionary for type", t.event_type.name());
+    dict = &i->second;
+  }
+  // Read the columns.
+  uint64_t num_columns;
+  if (!detail::varbyte::decode(num_columns, ptr, end))
+    return malformed();
+  auto expected_columns = meta_columns + 1;
+  if (t.columnar) {
+    auto r = get_if<record_type>(t.event_type);
+    if (!r)
+      return malformed();
+    expected_columns = meta_columns + leaves(*r);
+  }
+  if (num_columns != expected_columns)
+    return malformed();
+  t.columns.resize(num_columns);
+  t.proj = fields_ ? &project(t.event_type) : nullptr;
+  for (auto c = 0u; c < num_columns; ++c) {
+    // Skip the columns of unselected fields without uncompressing them.
+    auto skip = t.proj && (!is<record_type>(t.proj->projected)
+                           || (t.columnar && !t.proj->columns[c]));
+    if (skip) {
+      t.columns[c].clear();
+      if (!skip_section(ptr, end))
+        return malformed();
+    } else if (!read_section(ptr, end, method_, t.columns[c], dict)) {
+      return malformed();
+    }
+  }
+  return {};
+}
+
+batch::reader::projection const& batch::reader::project(type const& t) {
+  VAST_ASSERT(fields_ != nullptr);
+  auto i = projections_.find(t);
+  if (i != projections_.end())
+    return i->second;
+  auto& proj = projections_[t];
+  auto r = get_if<record_type>(t);
+  if (!r)
+    return proj;
+  record_type projected;
+  for (auto& o : *fields_) {
+    auto field_type = r->at(o);
+    auto k = r->resolve(o);
+    if (!field_type || !k)
+      return proj;
+    projected.fields.emplace_back(to_string(*k), *field_type);
+    proj.leaves.push_back(leaf_range(*r, o));
+  }
+  proj.columns.resize(meta_columns + leaves(*r));
+  for (auto c = 0u; c < meta_columns; ++c)
+    proj.columns[c] = true;
+  for (auto& range : proj.leaves)
+    for (auto c = range.first; c < range.second; ++c)
+      proj.columns[meta_columns + c] = true;
+  proj.projected = type{std::move(projected)};
+  proj.projected.name() = t.name();
+  return proj;
+}
+
+expected<bitmap>
+batch::reader::evaluate(offset const& field, relational_operator op,
+                        data const& rhs) {
+  auto malformed = [] { return fail<ec::parse_error>("malformed batch"); };
+  if (auto err = parse())
+    return err;
+  // Map positions to event IDs.
+  std::vector<event_id> ids;
+  for (auto i = select(batch_.ids_); !i.done(); i.next())
+    ids.push_back(i.get());
+  if (ids.size() != batch_.events())
+    return fail("batch lacks event IDs");
+  std::vector<event_id> hits;
+  auto fields = std::vector<offset>{field};
+  fields_ = &fields;
+  projections_.clear();
+  auto err = error{};
+  auto& t = table_;
+  for (auto& blk : blocks_) {
+    auto ptr = blk.data;
+    auto end = blk.data + blk.size;
+    uint64_t tables;
+    if (!detail::varbyte::decode(tables, ptr, end)) {
+      err = malformed();
+      break;
+    }
+    for (auto i = 0u; i < tables && !err; ++i) {
+      if ((err = read_table(ptr, end, t)))
+        break;
+      if (!is<record_type>(t.proj->projected))
+        continue; // The event type lacks the field.
+      auto& raw = t.columns[position_column];
+      auto positions = detail::column_view::make(raw.data(),
+                                                 raw.data() + raw.size(),
+                                                 blk.events);
+      if (!positions) {
+        err = positions.error();
+        break;
+      }
+      auto qualify = [&](size_t row, bool match) {
+        auto pos = get_if<count>((*positions)[row]);
+        if (!pos || *pos >= ids.size())
+          return false;
+        if (match)
+          hits.push_back(ids[*pos]);
+        return true;
+      };
+      auto& leaves = t.proj->leaves.front();
+      if (t.columnar && leaves.second - leaves.first == 1) {
+        // The field maps to a single column, which we evaluate in place.
+        auto& column = t.columns[meta_columns + leaves.first];
+        auto values = detail::column_view::make(column.data(),
+                                                column.data() + column.size(),
+                                                blk.events);
+        if (!values) {
+          err = values.error();
+          break;
+        }
+        if (values->size() != positions->size()) {
+          err = malformed();
+          break;
+        }
+        for (auto row = 0u; row < values->size() && !err; ++row)
+          if (!qualify(row, vast::evaluate((*values)[row], op, rhs)))
+            err = malformed();
+      } else {
+        // Nested records and values without columnar layout require decoding
+        // their values.
+        auto first = meta_columns + (t.columnar ? leaves.first : 0);
+        auto last = meta_columns + (t.columnar ? leaves.second : 1);
+        auto& columns = table_columns_;
+        columns.resize(last - first);
+        for (auto c = first; c < last && !err; ++c) {
+          auto& column = t.columns[c];
+          err = detail::decode_column(column.data(),
+                                      column.data() + column.size(),
+                                      columns[c - first], blk.events);
+          if (!err && columns[c - first].size() != positions->size())
+            err = malformed();
+        }
+        if (err)
+          break;
+        auto nested = static_cast<record_type const*>(nullptr);
+        if (t.columnar) {
+          auto r = get_if<record_type>(t.event_type);
+          nested = get_if<record_type>(*r->at(field));
+        }
+        for (auto row = 0u; row < positions->size() && !err; ++row) {
+          auto match = false;
+          if (nested) {
+            auto x = data{compose(*nested, columns.data(), row)};
+            match = vast::evaluate(x, op, rhs);
+          } else if (auto x = get(columns.front()[row], field)) {
+            match = vast::evaluate(*x, op, rhs);
+          }
+          if (!qualify(row, match))
+            err = malformed();
+        }
+      }
+    }
+    if (err)
+      break;
+  }
+  fields_ = nullptr;
+  if (err)
+    return err;
+  // Positions within blocks are unordered across tables.
+  std::sort(hits.begin(), hits.end());
+  bitmap result;
+  for (auto id : hits) {
+    result.append_bits(false, id - result.size());
+    result.append_bit(true);
+  }
   return result;
 }
 
-expected<event> batch::reader::materialize() {
-  if (available_ == 0)
-    return fail();
-  --available_;
-  // Read type.
-  uint32_t type_id;
-  deserializer_ >> type_id;
-  auto t = type_cache_.find(type_id);
-  if (t == type_cache_.end()) {
-    type new_type;
-    deserializer_ >> new_type;
-    t = type_cache_.emplace(type_id, std::move(new_type)).first;
-  }
-  // Read event timestamp and data.
-  timestamp ts;
-  data d;
-  deserializer_ >> ts >> d;
-  event e{{std::move(d), t->second}};
-  // Assign an event ID.
-  if (!id_range_.done()) {
-    e.id(id_range_.get());
-    id_range_.next();
-  }
-  e.timestamp(ts);
-  return e;
+error batch::reader::read_columns(column_function f) {
+  auto malformed = [] { return fail<ec::parse_error>("malformed batch"); };
+  if (auto err = parse())
+    return err;
+  // Map positions to event IDs.
+  std::vector<event_id> ids;
+  for (auto i = select(batch_.ids_); !i.done(); i.next())
+    ids.push_back(i.get());
+  if (ids.size() != batch_.events())
+    return fail("batch lacks event IDs");
+  fields_ = nullptr;
+  auto& t = table_;
+  auto& columns = table_columns_;
+  vector positions;
+  vector timestamps;
+  std::vector<event_id> rows;
+  for (auto& blk : blocks_) {
+    auto ptr = blk.data;
+    auto end = blk.data + blk.size;
+    uint64_t tables;
+    if (!detail::varbyte::decode(tables, ptr, end))
+      return malformed();
+    for (auto i = 0u; i < tables; ++i) {
+      if (auto err = read_table(ptr, end, t))
+        return err;
+      auto decode = [&](size_t c, vector& xs) {
+        auto& raw = t.columns[c];
+        return detail::decode_column(raw.data(), raw.data() + raw.size(), xs,
+                                     blk.events);
+      };
+      if (auto err = decode(position_column, positions))
+        return err;
+      if (auto err = decode(timestamp_column, timestamps))
+        return err;
+      if (timestamps.size() != positions.size())
+        return malformed();
+      columns.resize(t.columns.size() - meta_columns);
+      for (auto c = 0u; c < columns.size(); ++c) {
+        if (auto err = decode(meta_columns + c, columns[c]))
+          return err;
+        if (columns[c].size() != positions.size())
+          return malformed();
+      }
+      rows.clear();
+      for (auto row = 0u; row < positions.size(); ++row) {
+        auto pos = get_if<count>(positions[row]);
+        if (!pos || *pos < blk.first || *pos - blk.first >= blk.events
+            || !is<timestamp>(timestamps[row]))
+          return malformed();
+        rows.push_back(ids[*pos]);
+      }
+      f(t.event_type, t.columnar, rows, timestamps, columns);
+    }
+  }
+  return {};
+}
+
+expected<std::unordered_map<type, std::vector<std::vector<char>>>>
+batch::reader::columns() {
+  if (auto err = parse())
+    return err;
+  std::unordered_map<type, std::vector<std::vector<char>>> result;
+  table t;
+  for (auto& blk : blocks_) {
+    auto ptr = blk.data;
+    auto end = blk.data + blk.size;
+    uint64_t tables;
+    if (!detail::varbyte::decode(tables, ptr, end))
+      return fail<ec::parse_error>("malformed batch");
+    for (auto i = 0u; i < tables; ++i) {
+      if (auto err = read_table(ptr, end, t))
+        return err;
+      auto& xs = result[t.event_type];
+      std::move(t.columns.begin(), t.columns.end(), std::back_inserter(xs));
+    }
+  }
+  return result;
+}
+
+bool may_match(batch const& b, expression const& expr) {
+  if (b.events() == 0)
+    return false;
+  return visit(time_restrictor{b.first(), b.last()}, expr);
+}
+
+expected<batch::dictionary_map>
+train_dictionaries(std::vector<batch> const& batches, size_t max_size) {
+  std::unordered_map<type, std::vector<std::vector<char>>> samples;
+  for (auto& b : batches) {
+    batch::reader reader{b};
+    auto columns = reader.columns();
+    if (!columns)
+      return columns.error();
+    for (auto& pair : *columns) {
+      auto& xs = samples[pair.first];
+      std::move(pair.second.begin(), pair.second.end(),
+                std::back_inserter(xs));
+    }
+  }
+  batch::dictionary_map result;
+  for (auto& pair : samples)
+    if (auto dict = dictionary::train(pair.second, max_size))
+      result.emplace(pair.first, std::move(*dict));
+  return result;
 }
 
 } // namespace vast
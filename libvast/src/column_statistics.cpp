@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <limits>
+
+#include "vast/column_statistics.hpp"
+#include "vast/concept/hashable/hash_append.hpp"
+#include "vast/concept/hashable/xxhash.hpp"
+
+namespace vast {
+namespace {
+
+// A stateless pseudo-random number generator (SplitMix64), so that the
+// sample only depends on the sequence of values.
+uint64_t mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+// Feeds the bytes of a value into a hasher without serializing it first.
+struct hasher {
+  template <class T>
+  void operator()(T const& x) const {
+    hash_append(h, x);
+  }
+
+  void operator()(none) const {
+    // Nothing to hash.
+  }
+
+  void operator()(interval x) const {
+    hash_append(h, x.count());
+  }
+
+  void operator()(timestamp x) const {
+    hash_append(h, x.time_since_epoch().count());
+  }
+
+  void operator()(vector const& xs) const {
+    for (auto& x : xs)
+      visit(*this, x);
+    hash_append(h, xs.size());
+  }
+
+  void operator()(set const& xs) const {
+    for (auto& x : xs)
+      visit(*this, x);
+    hash_append(h, xs.size());
+  }
+
+  void operator()(table const& xs) const {
+    for (auto& x : xs) {
+      visit(*this, x.first);
+      visit(*this, x.second);
+    }
+    hash_append(h, xs.size());
+  }
+
+  xxhash64& h;
+};
+
+uint64_t hash(data const& x) {
+  xxhash64 h;
+  visit(hasher{h}, x);
+  return static_cast<uint64_t>(h);
+}
+
+} // namespace <anonymous>
+
+constexpr size_t column_statistics::sample_size;
+constexpr size_t column_statistics::sketch_size;
+
+void column_statistics::add(data const& x) {
+  ++count_;
+  if (is<none>(x)) {
+    ++nils_;
+    return;
+  }
+  // Reservoir sampling: the n-th value replaces a random sampled value with
+  // probability sample_size / n.
+  auto n = count_ - nils_;
+  if (sample_.size() < sample_size) {
+    sample_.push_back(x);
+  } else {
+    auto i = mix(n) % n;
+    if (i < sample_size)
+      sample_[i] = x;
+  }
+  // Keep the smallest distinct hash values.
+  auto h = hash(x);
+  if (minima_.size() == sketch_size && h >= minima_.back())
+    return;
+  auto i = std::lower_bound(minima_.begin(), minima_.end(), h);
+  if (i != minima_.end() && *i == h)
+    return;
+  minima_.insert(i, h);
+  if (minima_.size() > sketch_size)
+    minima_.pop_back();
+}
+
+uint64_t column_statistics::count() const {
+  return count_;
+}
+
+uint64_t column_statistics::distinct() const {
+  if (minima_.size() < sketch_size)
+    return minima_.size();
+  // The k-th smallest of n uniform hash values is about k / n of the range.
+  auto max = static_cast<double>(std::numeric_limits<uint64_t>::max());
+  return static_cast<uint64_t>((sketch_size - 1) * max / minima_.back());
+}
+
+double column_statistics::selectivity(relational_operator op,
+                                      data const& rhs) const {
+  if (count_ == 0)
+    return 0.0;
+  auto nils = static_cast<double>(nils_) / count_;
+  if (is<none>(rhs)) {
+    if (op == equal)
+      return nils;
+    if (op == not_equal)
+      return 1.0 - nils;
+  }
+  if (sample_.empty())
+    return 0.0;
+  auto matches = std::count_if(sample_.begin(), sample_.end(),
+                               [&](data const& x) {
+                                 return evaluate(x, op, rhs);
+                               });
+  auto result = static_cast<double>(matches) / sample_.size();
+  // A value missing from the sample may still occur, but not frequently.
+  auto rare = 1.0 / std::max(static_cast<double>(distinct()),
+                             static_cast<double>(sample_.size()));
+  if (op == equal && matches == 0)
+    result = rare;
+  else if (op == not_equal && result == 1.0)
+    result = 1.0 - rare;
+  return result * (1.0 - nils);
+}
+
+} // namespace vast
@@ -1,3 +1,7 @@
+#include <cstring>
+#include <map>
+#include <mutex>
+
 #include "lz4/lz4.h"
 
 #include "vast/compression.hpp"
@@ -7,7 +11,162 @@
 #include <snappy.h>
 #endif
 
+#ifdef VAST_HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+#include "vast/error.hpp"
+
 namespace vast {
+
+#ifdef VAST_HAVE_ZSTD
+struct dictionary::digest {
+  explicit digest(std::vector<char> xs)
+    : bytes{std::move(xs)},
+      decompression{ZSTD_createDDict(bytes.data(), bytes.size())} {
+  }
+
+  ~digest() {
+    ZSTD_freeDDict(decompression);
+    for (auto& pair : compression)
+      ZSTD_freeCDict(pair.second);
+  }
+
+  // Retrieves the digest for a compression level, creating it on first use.
+  ZSTD_CDict const* compress(int level) {
+    std::lock_guard<std::mutex> lock{mutex};
+    auto& result = compression[level];
+    if (result == nullptr)
+      result = ZSTD_createCDict(bytes.data(), bytes.size(), level);
+    return result;
+  }
+
+  std::vector<char> const bytes;
+  ZSTD_DDict* const decompression;
+  std::mutex mutex;
+  std::map<int, ZSTD_CDict*> compression;
+};
+#else
+struct dictionary::digest {
+  explicit digest(std::vector<char>) {
+  }
+};
+#endif // VAST_HAVE_ZSTD
+
+bool supports_dictionary(compression method) {
+#ifdef VAST_HAVE_ZSTD
+  return method == compression::zstd;
+#else
+  static_cast<void>(method);
+  return false;
+#endif
+}
+
+expected<dictionary> dictionary::train(
+  std::vector<std::vector<char>> const& samples, size_t max_size) {
+#ifdef VAST_HAVE_ZSTD
+  // The trainer expects all samples in one contiguous buffer.
+  std::vector<char> buffer;
+  std::vector<size_t> sizes;
+  sizes.reserve(samples.size());
+  for (auto& sample : samples) {
+    buffer.insert(buffer.end(), sample.begin(), sample.end());
+    sizes.push_back(sample.size());
+  }
+  dictionary result;
+  result.bytes_.resize(max_size);
+  auto n = ZDICT_trainFromBuffer(result.bytes_.data(), result.bytes_.size(),
+                                 buffer.data(), sizes.data(),
+                                 static_cast<unsigned>(sizes.size()));
+  if (ZDICT_isError(n))
+    return fail("failed to train dictionary:", ZDICT_getErrorName(n));
+  result.bytes_.resize(n);
+  return result;
+#else
+  static_cast<void>(samples);
+  static_cast<void>(max_size);
+  return fail("not compiled with Zstandard support");
+#endif
+}
+
+std::vector<char> const& dictionary::bytes() const {
+  return bytes_;
+}
+
+dictionary::digest& dictionary::digested() const {
+  // Concurrent readers may race to create the digest, but only one wins.
+  auto result = std::atomic_load(&digest_);
+  if (!result) {
+    auto fresh = std::make_shared<digest>(bytes_);
+    if (std::atomic_compare_exchange_strong(&digest_, &result, fresh))
+      result = std::move(fresh);
+  }
+  return *result;
+}
+
+void compress(compression method, char const* in, size_t in_size,
+              std::vector<char>& out, int level, dictionary const* dict) {
+  static_cast<void>(level);
+  static_cast<void>(dict);
+  size_t n = 0;
+  switch (method) {
+    case compression::null:
+      out.resize(in_size);
+      std::memcpy(out.data(), in, in_size);
+      n = in_size;
+      break;
+    case compression::lz4:
+      out.resize(lz4::compress_bound(in_size));
+      n = lz4::compress(in, in_size, out.data(), out.size());
+      break;
+#ifdef VAST_HAVE_SNAPPY
+    case compression::snappy:
+      out.resize(snappy::compress_bound(in_size));
+      n = snappy::compress(in, in_size, out.data());
+      break;
+#endif // VAST_HAVE_SNAPPY
+#ifdef VAST_HAVE_ZSTD
+    case compression::zstd:
+      out.resize(zstd::compress_bound(in_size));
+      n = zstd::compress(in, in_size, out.data(), out.size(),
+                         level == 0 ? zstd::default_level : level, dict);
+      break;
+#endif // VAST_HAVE_ZSTD
+  }
+  out.resize(n);
+}
+
+size_t uncompress(compression method, char const* in, size_t in_size,
+                  char* out, size_t out_size, dictionary const* dict) {
+  static_cast<void>(dict);
+  switch (method) {
+    case compression::null:
+      if (in_size > out_size)
+        return 0;
+      std::memcpy(out, in, in_size);
+      return in_size;
+    case compression::lz4: {
+      // LZ4 signals errors with negative values.
+      auto n = lz4::uncompress(in, in_size, out, out_size);
+      return n > out_size ? 0 : n;
+    }
+#ifdef VAST_HAVE_SNAPPY
+    case compression::snappy: {
+      auto n = snappy::uncompress_bound(in, in_size);
+      if (n > out_size || !snappy::uncompress(in, in_size, out))
+        return 0;
+      return n;
+    }
+#endif // VAST_HAVE_SNAPPY
+#ifdef VAST_HAVE_ZSTD
+    case compression::zstd:
+      return zstd::uncompress(in, in_size, out, out_size, dict);
+#endif // VAST_HAVE_ZSTD
+  }
+  return 0;
+}
+
 namespace lz4 {
 
 size_t compress_bound(size_t size) {
@@ -52,4 +211,41 @@ bool uncompress(char const* in, size_t in_size, char* out) {
 } // namespace snappy
 #endif // VAST_HAVE_SNAPPY
 
+#ifdef VAST_HAVE_ZSTD
+namespace zstd {
+
+size_t compress_bound(size_t size) {
+  return ZSTD_compressBound(size);
+}
+
+size_t compress(char const* in, size_t in_size, char* out, size_t out_size,
+                int level, dictionary const* dict) {
+  // Reusing a context per thread saves its allocation for every input.
+  static thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> ctx{
+    ZSTD_createCCtx(), ZSTD_freeCCtx};
+  size_t n;
+  if (dict == nullptr || dict->bytes().empty())
+    n = ZSTD_compressCCtx(ctx.get(), out, out_size, in, in_size, level);
+  else
+    n = ZSTD_compress_usingCDict(ctx.get(), out, out_size, in, in_size,
+                                 dict->digested().compress(level));
+  return ZSTD_isError(n) ? 0 : n;
+}
+
+size_t uncompress(char const* in, size_t in_size, char* out, size_t out_size,
+                  dictionary const* dict) {
+  static thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> ctx{
+    ZSTD_createDCtx(), ZSTD_freeDCtx};
+  size_t n;
+  if (dict == nullptr || dict->bytes().empty())
+    n = ZSTD_decompressDCtx(ctx.get(), out, out_size, in, in_size);
+  else
+    n = ZSTD_decompress_usingDDict(ctx.get(), out, out_size, in, in_size,
+                                   dict->digested().decompression);
+  return ZSTD_isError(n) ? 0 : n;
+}
+
+} // namespace zstd
+#endif // VAST_HAVE_ZSTD
+
 } // namespace vast
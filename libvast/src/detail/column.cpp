@@ -0,0 +1,492 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include <caf/stream_deserializer.hpp>
+#include <caf/stream_serializer.hpp>
+#include <caf/streambuf.hpp>
+
+#include "vast/data.hpp"
+#include "vast/error.hpp"
+#include "vast/view.hpp"
+#include "vast/detail/assert.hpp"
+#include "vast/detail/column.hpp"
+#include "vast/detail/type_list.hpp"
+#include "vast/detail/varbyte.hpp"
+#include "vast/detail/zigzag.hpp"
+
+namespace vast {
+namespace detail {
+namespace {
+
+// The kind of a column corresponds to the variant index of its values.
+template <class T>
+constexpr uint8_t kind = tl_index_of<data_variant::types, T>::value;
+
+// Columns with values of different types fall back to CAF serialization.
+constexpr uint8_t generic_kind = 0xff;
+
+// -- encoding ---------------------------------------------------------------
+
+template <class T>
+void put_varbyte(std::vector<char>& sink, T x) {
+  char buf[varbyte::max_size<T>()];
+  auto n = varbyte::encode(x, buf);
+  sink.insert(sink.end(), buf, buf + n);
+}
+
+void put_bytes(std::vector<char>& sink, void const* data, size_t size) {
+  auto ptr = reinterpret_cast<char const*>(data);
+  sink.insert(sink.end(), ptr, ptr + size);
+}
+
+template <class Predicate>
+void put_bits(std::vector<char>& sink, size_t n, Predicate pred) {
+  auto offset = sink.size();
+  sink.resize(offset + (n + 7) / 8, 0);
+  for (auto i = 0u; i < n; ++i)
+    if (pred(i))
+      sink[offset + i / 8] |= static_cast<char>(1 << (i % 8));
+}
+
+// Writes the difference of each value to its predecessor.
+template <class F>
+void put_deltas(std::vector<char>& sink, std::vector<data const*> const& xs,
+                F f) {
+  auto prev = uint64_t{0};
+  for (auto x : xs) {
+    auto value = static_cast<uint64_t>(f(*x));
+    put_varbyte(sink, zigzag::encode(static_cast<int64_t>(value - prev)));
+    prev = value;
+  }
+}
+
+void put_strings(std::vector<char>& sink, std::vector<data const*> const& xs) {
+  std::unordered_map<std::string, uint64_t> dictionary;
+  std::vector<std::string const*> entries;
+  std::vector<uint64_t> codes;
+  codes.reserve(xs.size());
+  for (auto x : xs) {
+    auto& str = get<std::string>(*x);
+    auto i = dictionary.emplace(str, entries.size());
+    if (i.second)
+      entries.push_back(&str);
+    codes.push_back(i.first->second);
+  }
+  // Only columns with low cardinality benefit from a dictionary.
+  if (entries.size() <= xs.size() / 2) {
+    sink.push_back(1);
+    put_varbyte(sink, static_cast<uint64_t>(entries.size()));
+    for (auto str : entries) {
+      put_varbyte(sink, static_cast<uint64_t>(str->size()));
+      put_bytes(sink, str->data(), str->size());
+    }
+    for (auto code : codes)
+      put_varbyte(sink, code);
+  } else {
+    sink.push_back(0);
+    for (auto x : xs) {
+      auto& str = get<std::string>(*x);
+      put_varbyte(sink, static_cast<uint64_t>(str.size()));
+      put_bytes(sink, str.data(), str.size());
+    }
+  }
+}
+
+void put_generic(std::vector<char>& sink, std::vector<data const*> const& xs) {
+  vector values;
+  values.reserve(xs.size());
+  for (auto x : xs)
+    values.push_back(*x);
+  caf::vectorbuf buf{sink};
+  caf::stream_serializer<caf::vectorbuf&> serializer{buf};
+  serializer << values;
+}
+
+// -- decoding ---------------------------------------------------------------
+
+// A bounds-checked view on encoded bytes.
+class source {
+public:
+  source(char const* begin, char const* end) : ptr_{begin}, end_{end} {
+  }
+
+  char const* ptr() const {
+    return ptr_;
+  }
+
+  size_t available() const {
+    return end_ - ptr_;
+  }
+
+  template <class T>
+  bool get_varbyte(T& x) {
+    return varbyte::decode(x, ptr_, end_);
+  }
+
+  bool get_bytes(void* data, size_t size) {
+    if (available() < size)
+      return false;
+    std::memcpy(data, ptr_, size);
+    ptr_ += size;
+    return true;
+  }
+
+  template <class String>
+  bool get_string(String& str) {
+    uint64_t size;
+    if (!get_varbyte(size) || available() < size)
+      return false;
+    str = String(ptr_, size);
+    ptr_ += size;
+    return true;
+  }
+
+  bool get_bits(std::vector<bool>& bits, size_t n) {
+    auto bytes = (n + 7) / 8;
+    if (available() < bytes)
+      return false;
+    bits.resize(n);
+    for (auto i = 0u; i < n; ++i)
+      bits[i] = (static_cast<uint8_t>(ptr_[i / 8]) >> (i % 8)) & 1;
+    ptr_ += bytes;
+    return true;
+  }
+
+private:
+  char const* ptr_;
+  char const* end_;
+};
+
+// The header of an encoded column.
+struct column_header {
+  uint64_t values;
+  uint8_t kind;
+  std::vector<bool> mask; // empty if all values are valid
+  uint64_t valid;
+};
+
+// Reads the header of a column. Since the number of values stems from
+// untrusted input, it must not exceed the given maximum, and each valid value
+// must occupy at least one bit of the remaining input.
+bool get_header(source& src, column_header& h, size_t max_values) {
+  char validity;
+  if (!src.get_varbyte(h.values) || h.values > max_values
+      || !src.get_bytes(&h.kind, 1) || !src.get_bytes(&validity, 1))
+    return false;
+  h.mask.clear();
+  if (validity != 0 && !src.get_bits(h.mask, h.values))
+    return false;
+  h.valid = h.values;
+  if (h.kind == kind<none>)
+    h.valid = 0;
+  else if (!h.mask.empty())
+    h.valid = std::count(h.mask.begin(), h.mask.end(), true);
+  return h.valid / 8 <= src.available();
+}
+
+template <class Values, class F>
+bool get_deltas(source& src, size_t n, Values& xs, F f) {
+  auto prev = uint64_t{0};
+  for (auto i = 0u; i < n; ++i) {
+    uint64_t delta;
+    if (!src.get_varbyte(delta))
+      return false;
+    prev += static_cast<uint64_t>(zigzag::decode(delta));
+    xs.push_back(f(prev));
+  }
+  return true;
+}
+
+// Decodes strings as `String`, which is either an owning string or a view.
+template <class String, class Values>
+bool get_strings(source& src, size_t n, Values& xs) {
+  char mode;
+  if (!src.get_bytes(&mode, 1))
+    return false;
+  if (mode == 0) {
+    for (auto i = 0u; i < n; ++i) {
+      String str;
+      if (!src.get_string(str))
+        return false;
+      xs.push_back(std::move(str));
+    }
+    return true;
+  }
+  uint64_t size;
+  if (!src.get_varbyte(size) || size > src.available())
+    return false;
+  std::vector<String> entries(size);
+  for (auto& entry : entries)
+    if (!src.get_string(entry))
+      return false;
+  for (auto i = 0u; i < n; ++i) {
+    uint64_t code;
+    if (!src.get_varbyte(code) || code >= entries.size())
+      return false;
+    xs.push_back(entries[code]);
+  }
+  return true;
+}
+
+bool get_generic(source& src, size_t n, vector& xs) {
+  caf::charbuf buf{const_cast<char*>(src.ptr()), src.available()};
+  caf::stream_deserializer<caf::charbuf&> deserializer{buf};
+  deserializer >> xs;
+  return xs.size() == n;
+}
+
+// Checks whether the values of a column kind use CAF serialization. Besides
+// mixed columns, this includes homogeneous columns of containers, patterns,
+// and enumerations, which keep their own kind.
+bool is_generic(uint8_t k) {
+  switch (k) {
+    default:
+      return true;
+    case kind<none>:
+    case kind<boolean>:
+    case kind<integer>:
+    case kind<count>:
+    case kind<interval>:
+    case kind<timestamp>:
+    case kind<real>:
+    case kind<std::string>:
+    case kind<address>:
+    case kind<subnet>:
+    case kind<port>:
+      return false;
+  }
+}
+
+// Decodes the valid values of a column. The callers handle generic columns.
+template <class String, class Values>
+bool get_values(source& src, column_header const& h, Values& xs) {
+  auto m = h.valid;
+  xs.clear();
+  xs.reserve(m);
+  auto success = true;
+  switch (h.kind) {
+    default:
+      return false;
+    case kind<none>:
+      break;
+    case kind<boolean>: {
+      std::vector<bool> bits;
+      success = src.get_bits(bits, m);
+      for (auto bit : bits)
+        xs.push_back(boolean{bit});
+      break;
+    }
+    case kind<integer>:
+      success = get_deltas(src, m, xs, [](uint64_t x) {
+        return static_cast<integer>(x);
+      });
+      break;
+    case kind<count>:
+      success = get_deltas(src, m, xs, [](uint64_t x) {
+        return count{x};
+      });
+      break;
+    case kind<interval>:
+      success = get_deltas(src, m, xs, [](uint64_t x) {
+        return interval{static_cast<interval::rep>(x)};
+      });
+      break;
+    case kind<timestamp>:
+      success = get_deltas(src, m, xs, [](uint64_t x) {
+        return timestamp{interval{static_cast<interval::rep>(x)}};
+      });
+      break;
+    case kind<real>:
+      for (auto i = 0u; i < m && success; ++i) {
+        real x;
+        success = src.get_bytes(&x, sizeof(real));
+        xs.push_back(x);
+      }
+      break;
+    case kind<std::string>:
+      success = get_strings<String>(src, m, xs);
+      break;
+    case kind<address>:
+      for (auto i = 0u; i < m && success; ++i) {
+        uint32_t bytes[4];
+        success = src.get_bytes(bytes, 16);
+        xs.push_back(address{bytes, address::ipv6, address::network});
+      }
+      break;
+    case kind<subnet>:
+      for (auto i = 0u; i < m && success; ++i) {
+        uint32_t bytes[4];
+        uint8_t length;
+        success = src.get_bytes(bytes, 16) && src.get_bytes(&length, 1);
+        xs.push_back(
+          subnet{address{bytes, address::ipv6, address::network}, length});
+      }
+      break;
+    case kind<port>:
+      for (auto i = 0u; i < m && success; ++i) {
+        port::number_type number;
+        uint8_t type;
+        success = src.get_varbyte(number) && src.get_bytes(&type, 1);
+        xs.push_back(port{number, static_cast<port::port_type>(type)});
+      }
+      break;
+  }
+  return success && xs.size() == m;
+}
+
+// Interleaves the valid values with nils according to the mask. Going
+// backwards, each value moves to a position at or after its current one.
+template <class Values>
+void interleave(column_header const& h, Values& xs) {
+  using value_type = typename Values::value_type;
+  if (h.mask.empty()) {
+    if (h.kind == kind<none>)
+      xs.resize(h.values);
+    return;
+  }
+  xs.resize(h.values);
+  auto j = h.valid;
+  for (auto i = h.values; i > 0; --i) {
+    if (!h.mask[i - 1])
+      xs[i - 1] = value_type{};
+    else if (--j != i - 1)
+      xs[i - 1] = std::move(xs[j]);
+  }
+}
+
+} // namespace <anonymous>
+
+void encode_column(vector const& xs, std::vector<char>& sink) {
+  put_varbyte(sink, static_cast<uint64_t>(xs.size()));
+  // Determine the column kind and the non-nil values.
+  std::vector<data const*> valid;
+  valid.reserve(xs.size());
+  auto k = kind<none>;
+  for (auto& x : xs) {
+    auto i = static_cast<uint8_t>(expose(x).index());
+    if (i == kind<none>)
+      continue;
+    if (valid.empty())
+      k = i;
+    else if (i != k)
+      k = generic_kind;
+    valid.push_back(&x);
+  }
+  sink.push_back(static_cast<char>(k));
+  if (valid.empty() || valid.size() == xs.size()) {
+    sink.push_back(0);
+  } else {
+    sink.push_back(1);
+    put_bits(sink, xs.size(), [&](size_t i) { return !is<none>(xs[i]); });
+  }
+  switch (k) {
+    default:
+      put_generic(sink, valid);
+      break;
+    case kind<none>:
+      break;
+    case kind<boolean>:
+      put_bits(sink, valid.size(),
+               [&](size_t i) { return get<boolean>(*valid[i]); });
+      break;
+    case kind<integer>:
+      put_deltas(sink, valid, [](auto& x) { return get<integer>(x); });
+      break;
+    case kind<count>:
+      put_deltas(sink, valid, [](auto& x) { return get<count>(x); });
+      break;
+    case kind<interval>:
+      put_deltas(sink, valid,
+                 [](auto& x) { return get<interval>(x).count(); });
+      break;
+    case kind<timestamp>:
+      put_deltas(sink, valid, [](auto& x) {
+        return get<timestamp>(x).time_since_epoch().count();
+      });
+      break;
+    case kind<real>:
+      for (auto x : valid)
+        put_bytes(sink, &get<real>(*x), sizeof(real));
+      break;
+    case kind<std::string>:
+      put_strings(sink, valid);
+      break;
+    case kind<address>:
+      for (auto x : valid)
+        put_bytes(sink, get<address>(*x).data().data(), 16);
+      break;
+    case kind<subnet>:
+      for (auto x : valid) {
+        auto& sn = get<subnet>(*x);
+        put_bytes(sink, sn.network().data().data(), 16);
+        sink.push_back(static_cast<char>(sn.length()));
+      }
+      break;
+    case kind<port>:
+      for (auto x : valid) {
+        auto& p = get<port>(*x);
+        put_varbyte(sink, p.number());
+        sink.push_back(static_cast<char>(p.type()));
+      }
+      break;
+  }
+}
+
+expected<vector> decode_column(char const* begin, char const* end,
+                               size_t max_values) {
+  vector xs;
+  if (auto err = decode_column(begin, end, xs, max_values))
+    return err;
+  return xs;
+}
+
+error decode_column(char const* begin, char const* end, vector& xs,
+                    size_t max_values) {
+  source src{begin, end};
+  column_header h;
+  if (!get_header(src, h, max_values))
+    return fail<ec::parse_error>("malformed column");
+  auto success = is_generic(h.kind)
+    ? get_generic(src, h.valid, xs)
+    : get_values<std::string>(src, h, xs);
+  if (!success)
+    return fail<ec::parse_error>("malformed column");
+  interleave(h, xs);
+  return {};
+}
+
+expected<column_view> column_view::make(char const* begin, char const* end,
+                                        size_t max_values) {
+  column_view result;
+  source src{begin, end};
+  column_header h;
+  if (!get_header(src, h, max_values))
+    return fail<ec::parse_error>("malformed column");
+  auto& xs = result.views_;
+  if (is_generic(h.kind)) {
+    // Mixed values get materialized, so that the views reference them.
+    if (!get_generic(src, h.valid, result.values_))
+      return fail<ec::parse_error>("malformed column");
+    xs.reserve(h.valid);
+    for (auto& x : result.values_)
+      xs.push_back(make_view(x));
+  } else if (!get_values<string_view>(src, h, xs)) {
+    return fail<ec::parse_error>("malformed column");
+  }
+  interleave(h, xs);
+  return result;
+}
+
+size_t column_view::size() const {
+  return views_.size();
+}
+
+data_view const& column_view::operator[](size_t i) const {
+  VAST_ASSERT(i < views_.size());
+  return views_[i];
+}
+
+} // namespace detail
+} // namespace vast
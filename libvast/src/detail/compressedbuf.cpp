@@ -1,20 +1,78 @@
+#include <algorithm>
 #include <cstring>
 
 #include "vast/detail/assert.hpp"
-#include "vast/detail/byte_swap.hpp"
 #include "vast/detail/compressedbuf.hpp"
+#include "vast/detail/thread_pool.hpp"
 #include "vast/detail/varbyte.hpp"
 
 namespace vast {
 namespace detail {
+namespace {
+
+using traits_type = std::streambuf::traits_type;
+
+// Compresses a block and prepends the header.
+std::vector<char> make_block(compression method, int level, char const* ptr,
+                             size_t size) {
+  std::vector<char> compressed;
+  vast::compress(method, ptr, size, compressed, level);
+  char header[2 * varbyte::max_size<size_t>()];
+  auto n = varbyte::encode(size, header);
+  n += varbyte::encode(compressed.size(), header + n);
+  std::vector<char> block;
+  block.reserve(n + compressed.size());
+  block.insert(block.end(), header, header + n);
+  block.insert(block.end(), compressed.begin(), compressed.end());
+  return block;
+}
+
+bool read_varbyte(std::streambuf& source, uint32_t& x) {
+  char buf[varbyte::max_size<uint32_t>()];
+  auto p = buf;
+  traits_type::int_type c;
+  do {
+    if (p == buf + sizeof(buf))
+      return false;
+    c = source.sbumpc();
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+      return false;
+    *p++ = traits_type::to_char_type(c);
+  } while (c & 0x80);
+  varbyte::decode(x, buf);
+  return true;
+}
+
+// Reads the header and the compressed data of the next block.
+bool read_block(std::streambuf& source, uint32_t& size,
+                std::vector<char>& compressed) {
+  uint32_t compressed_size;
+  if (!read_varbyte(source, size) || !read_varbyte(source, compressed_size))
+    return false;
+  compressed.resize(compressed_size);
+  auto got = source.sgetn(compressed.data(), compressed_size);
+  return got == static_cast<std::streamsize>(compressed_size);
+}
+
+// Uncompresses a block, leaving *out* empty on failure.
+void uncompress_block(compression method, std::vector<char> const& compressed,
+                      size_t size, std::vector<char>& out) {
+  out.resize(size);
+  auto n = vast::uncompress(method, compressed.data(), compressed.size(),
+                            out.data(), out.size());
+  out.resize(n);
+}
+
+} // namespace <anonymous>
 
 compressedbuf::compressedbuf(std::streambuf& sb, compression method,
-                            size_t block_size)
+                             size_t block_size, int level, thread_pool* pool)
   : streambuf_{sb},
     method_{method},
-    block_size_{block_size} {
+    block_size_{block_size},
+    level_{level},
+    pool_{pool} {
   VAST_ASSERT(block_size > 0);
-  compressed_.resize(block_size_);
   uncompressed_.resize(block_size_);
   setp(uncompressed_.data(), uncompressed_.data() + uncompressed_.size());
 }
@@ -22,42 +80,22 @@ compressedbuf::compressedbuf(std::streambuf& sb, compression method,
 int compressedbuf::sync() {
   if (pbase() == nullptr)
     return -1;
-  if (uncompressed_.empty())
-    return 0;
-  size_t uncompressed_size = pptr() - pbase();
-  uncompressed_.resize(uncompressed_size);
-  compress();
-  auto total = 0;
-  // Write header.
-  char size[16];
-  auto n = varbyte::encode(uncompressed_size, size);
-  size_t put = streambuf_.sputn(size, n);
-  if (put != n)
+  auto flushed = flush_block();
+  if (flushed < 0)
     return -1;
-  total += put;
-  n = varbyte::encode(compressed_.size(), size);
-  put = streambuf_.sputn(size, n);
-  if (put != n)
+  auto drained = drain(0);
+  if (drained < 0)
     return -1;
-  total += put;
-  // Write data block.
-  put = streambuf_.sputn(compressed_.data(), compressed_.size());
-  if (put != compressed_.size())
-    return -1;
-  total += put;
-  // Reset put area.
-  setp(uncompressed_.data(), uncompressed_.data() + uncompressed_.size());
-  return total;
+  return flushed + drained;
 }
 
 compressedbuf::int_type compressedbuf::overflow(int_type c) {
   // Handle given character.
   if (traits_type::eq_int_type(c, traits_type::eof()))
     return traits_type::not_eof(c);
-  auto bytes = sync();
-  if (bytes < 0)
+  if (flush_block() < 0)
     return traits_type::eof(); // indicates failure
-  uncompressed_[0] = traits_type::to_char_type(c);
+  *pptr() = traits_type::to_char_type(c);
   pbump(1);
   return c;
 }
@@ -81,35 +119,23 @@ std::streamsize compressedbuf::xsputn(char_type const* s, std::streamsize n) {
 
 compressedbuf::int_type compressedbuf::underflow() {
   VAST_ASSERT(gptr() == nullptr || gptr() >= egptr());
-  // Read header.
-  static auto read_varbyte = [](std::streambuf& source, char* sink) -> bool{
-    auto p = sink;
-    char c;
+  if (pool_) {
+    fetch();
+    if (pending_.empty())
+      return traits_type::eof();
+    uncompressed_ = pending_.front().get();
+    pending_.pop_front();
+  } else {
+    uint32_t size;
     do {
-      c = source.sbumpc();
-      if (traits_type::eq_int_type(c, traits_type::eof()))
-         return false;
-      *p++ = traits_type::to_char_type(c);
-    } while (c & 0x80);
-    return true;
-  };
-  char size[16];
-  uint32_t uncompressed_size, compressed_size;
-  if (!read_varbyte(streambuf_, size))
-    return traits_type::eof();
-  varbyte::decode(uncompressed_size, size);
-  if (!read_varbyte(streambuf_, size))
-    return traits_type::eof();
-  varbyte::decode(compressed_size, size);
-  // Adjust buffers.
-  uncompressed_.resize(uncompressed_size);
-  compressed_.resize(compressed_size);
-  // Retrieve compressed data block.
-  size_t got = streambuf_.sgetn(compressed_.data(), compressed_size);
-  if (got != compressed_size)
+      if (!read_block(streambuf_, size, compressed_))
+        return traits_type::eof();
+    } while (size == 0);
+    uncompress_block(method_, compressed_, size, uncompressed_);
+  }
+  // An empty block indicates a decompression failure.
+  if (uncompressed_.empty())
     return traits_type::eof();
-  // Uncompress data.
-  uncompress();
   // Reset get area.
   setg(uncompressed_.data(),
        uncompressed_.data(),
@@ -138,59 +164,61 @@ std::streamsize compressedbuf::xsgetn(char_type* s, std::streamsize n) {
   return got;
 }
 
-void compressedbuf::compress() {
-  size_t n = 0;
-  switch (method_) {
-    case compression::null:
-      compressed_.resize(uncompressed_.size());
-      std::memcpy(compressed_.data(), uncompressed_.data(),
-                  uncompressed_.size());
-      n = uncompressed_.size();
-      break;
-    case compression::lz4: {
-      compressed_.resize(lz4::compress_bound(uncompressed_.size()));
-      n = lz4::compress(uncompressed_.data(), uncompressed_.size(),
-                        compressed_.data(), compressed_.size());
-      break;
-    }
-#ifdef VAST_HAVE_SNAPPY
-    case compression::snappy: {
-      compressed_.resize(snappy::compress_bound(uncompressed_.size()));
-      n = snappy::compress(pbase(), uncompressed_.size(), compressed_.data());
-      break;
-    }
-#endif // VAST_HAVE_SNAPPY
+int compressedbuf::flush_block() {
+  auto size = static_cast<size_t>(pptr() - pbase());
+  if (size == 0)
+    return 0;
+  auto result = 0;
+  if (pool_) {
+    auto method = method_;
+    auto level = level_;
+    std::vector<char> bytes(pbase(), pptr());
+    pending_.push_back(pool_->submit([=, bytes = std::move(bytes)] {
+      return make_block(method, level, bytes.data(), bytes.size());
+    }));
+    result = drain(max_pending());
+  } else {
+    auto block = make_block(method_, level_, pbase(), size);
+    auto put = streambuf_.sputn(block.data(), block.size());
+    result = put == static_cast<std::streamsize>(block.size()) ? put : -1;
   }
-  compressed_.resize(n);
-  uncompressed_.resize(block_size_);
+  // Reset put area.
+  setp(uncompressed_.data(), uncompressed_.data() + uncompressed_.size());
+  return result;
 }
 
-void compressedbuf::uncompress() {
-  size_t n = 0;
-  switch (method_) {
-    case compression::null: {
-      std::memcpy(uncompressed_.data(), compressed_.data(), compressed_.size());
-      n = compressed_.size();
-      break;
-    }
-    case compression::lz4: {
-      n = lz4::uncompress(compressed_.data(), compressed_.size(),
-                          uncompressed_.data(), uncompressed_.size());
-      break;
-    }
-#ifdef VAST_HAVE_SNAPPY
-    case compression::snappy: {
-      auto success = snappy::uncompress(compressed_.data(), compressed_.size(),
-                                        uncompressed_.data());
-      VAST_ASSERT(success);
-      n = snappy::uncompress_bound(compressed_.data(), compressed_.size());
-      break;
-    }
-#endif // VAST_HAVE_SNAPPY
+int compressedbuf::drain(size_t n) {
+  auto total = 0;
+  while (pending_.size() > n) {
+    auto block = pending_.front().get();
+    pending_.pop_front();
+    auto put = streambuf_.sputn(block.data(), block.size());
+    if (put != static_cast<std::streamsize>(block.size()))
+      return -1;
+    total += put;
   }
-  VAST_ASSERT(n > 0);
-  uncompressed_.resize(n);
-  compressed_.resize(block_size_);
+  return total;
+}
+
+void compressedbuf::fetch() {
+  while (pending_.size() < max_pending()) {
+    uint32_t size;
+    std::vector<char> compressed;
+    if (!read_block(streambuf_, size, compressed))
+      return;
+    if (size == 0)
+      continue;
+    auto method = method_;
+    pending_.push_back(pool_->submit([=, compressed = std::move(compressed)] {
+      std::vector<char> result;
+      uncompress_block(method, compressed, size, result);
+      return result;
+    }));
+  }
+}
+
+size_t compressedbuf::max_pending() const {
+  return pool_ ? 2 * pool_->size() : 0;
 }
 
 } // namespace detail
@@ -1,7 +1,9 @@
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/un.h>
 
@@ -212,6 +214,22 @@ bool read(int fd, void* buffer, size_t bytes, size_t* got) {
   return true;
 }
 
+bool pread(int fd, void* buffer, size_t bytes, uint64_t offset) {
+  auto total = size_t{0};
+  auto buf = reinterpret_cast<uint8_t*>(buffer);
+  while (total < bytes) {
+    ssize_t taken;
+    do {
+      taken = ::pread(fd, buf + total, bytes - total,
+                      static_cast<off_t>(offset + total));
+    } while (taken < 0 && errno == EINTR);
+    if (taken <= 0)
+      return false;
+    total += static_cast<size_t>(taken);
+  }
+  return true;
+}
+
 bool write(int fd, void const* buffer, size_t bytes, size_t* put) {
   auto total = size_t{0};
   auto buf = reinterpret_cast<uint8_t const*>(buffer);
@@ -233,5 +251,42 @@ bool seek(int fd, size_t bytes) {
   return ::lseek(fd, bytes, SEEK_CUR) != -1;
 }
 
+bool file_size(int fd, size_t& size) {
+  struct ::stat st;
+  if (::fstat(fd, &st) != 0)
+    return false;
+  size = static_cast<size_t>(st.st_size);
+  return true;
+}
+
+bool truncate(int fd, uint64_t size) {
+  int result;
+  do {
+    result = ::ftruncate(fd, static_cast<off_t>(size));
+  } while (result != 0 && errno == EINTR);
+  return result == 0;
+}
+
+bool fsync(int fd) {
+  int result;
+  do {
+    result = ::fsync(fd);
+  } while (result != 0 && errno == EINTR);
+  return result == 0;
+}
+
+void* map(int fd, size_t size) {
+  auto addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  return addr == MAP_FAILED ? nullptr : addr;
+}
+
+bool unmap(void* addr, size_t size) {
+  return ::munmap(addr, size) == 0;
+}
+
+bool advise(void* addr, size_t size, int advice) {
+  return ::madvise(addr, size, advice) == 0;
+}
+
 } // namespace detail
 } // namespace vast
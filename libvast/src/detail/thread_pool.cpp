@@ -0,0 +1,39 @@
+#include <algorithm>
+
+#include "vast/detail/thread_pool.hpp"
+
+namespace vast {
+namespace detail {
+
+thread_pool::thread_pool(size_t size) {
+  if (size == 0)
+    size = std::max(1u, std::thread::hardware_concurrency());
+  threads_.reserve(size);
+  for (auto i = 0u; i < size; ++i)
+    threads_.emplace_back([=] { run(); });
+}
+
+thread_pool::~thread_pool() {
+  for (auto i = 0u; i < threads_.size(); ++i)
+    tasks_.push({});
+  for (auto& t : threads_)
+    t.join();
+}
+
+size_t thread_pool::size() const {
+  return threads_.size();
+}
+
+bool thread_pool::owns_current_thread() const {
+  auto self = std::this_thread::get_id();
+  return std::any_of(threads_.begin(), threads_.end(),
+                     [=](std::thread const& t) { return t.get_id() == self; });
+}
+
+void thread_pool::run() {
+  while (auto task = tasks_.pop())
+    task();
+}
+
+} // namespace detail
+} // namespace vast
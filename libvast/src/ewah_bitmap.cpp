@@ -75,6 +75,10 @@ ewah_bitmap::block_vector const& ewah_bitmap::blocks() const {
   return blocks_;
 }
 
+size_t ewah_bitmap::memusage() const {
+  return blocks_.capacity() * sizeof(block_type);
+}
+
 void ewah_bitmap::append_bit(bool bit) {
   auto partial = num_bits_ % ewah::word::width;
   if (blocks_.empty()) {
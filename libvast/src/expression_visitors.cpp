@@ -6,6 +6,8 @@
 #include "vast/concept/printable/to_string.hpp"
 #include "vast/concept/printable/vast/data.hpp"
 #include "vast/concept/printable/vast/type.hpp"
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/column_statistics.hpp"
 #include "vast/data.hpp"
 #include "vast/detail/assert.hpp"
 #include "vast/die.hpp"
@@ -205,6 +207,42 @@ maybe<void> validator::operator()(predicate const& p) const {
 }
 
 
+namespace {
+
+// Checks whether some timestamp in [first, last] can satisfy `x op y`.
+bool overlaps(timestamp first, timestamp last, relational_operator op,
+              timestamp y) {
+  switch (op) {
+    default:
+      return true; // nothing to restrict.
+    case equal:
+      return first <= y && y <= last;
+    case not_equal:
+      return !(first == y && last == y);
+    case less:
+      return first < y;
+    case less_equal:
+      return first <= y;
+    case greater:
+      return last > y;
+    case greater_equal:
+      return last >= y;
+  }
+}
+
+// Retrieves the timestamp of a predicate with a time extractor.
+timestamp const* time_operand(predicate const& p) {
+  if (auto a = get_if<attribute_extractor>(p.lhs))
+    if (a->attr == "time") {
+      auto d = get_if<data>(p.rhs);
+      VAST_ASSERT(d && is<timestamp>(*d)); // require validation
+      return &get<timestamp>(*d);
+    }
+  return nullptr;
+}
+
+} // namespace <anonymous>
+
 time_restrictor::time_restrictor(timestamp first, timestamp last)
   : first_{first}, last_{last} {
 }
@@ -232,26 +270,18 @@ bool time_restrictor::operator()(negation const& n) const {
   // We can only apply a negation if it sits directly on top of a time
   // extractor, because only then we can negate the meaning of the temporal
   // constraint.
-  auto r = visit(*this, n.expr());
   if (auto p = get_if<predicate>(n.expr()))
-    if (auto a = get_if<attribute_extractor>(p->lhs))
-      if (a->attr == "time")
-        return !r;
-  return r;
+    if (auto y = time_operand(*p))
+      return overlaps(first_, last_, negate(p->op), *y);
+  return true;
 }
 
 bool time_restrictor::operator()(predicate const& p) const {
-  if (auto a = get_if<attribute_extractor>(p.lhs)) {
-    if (a->attr == "time") {
-      auto d = get_if<data>(p.rhs);
-      VAST_ASSERT(d && is<timestamp>(*d)); // require validation
-      return evaluate(first_, p.op, *d) || evaluate(last_, p.op, *d);
-    }
-  }
+  if (auto y = time_operand(p))
+    return overlaps(first_, last_, p.op, *y);
   return true; // nothing to retrict.
 }
 
-
 key_resolver::key_resolver(type const& t) : type_{t} {
 }
 
@@ -485,4 +515,144 @@ bool event_evaluator::operator()(data_extractor const& e, data const& d) {
   return false;
 }
 
+selectivity_estimator::selectivity_estimator(statistics_function f)
+  : statistics_{std::move(f)} {
+}
+
+double selectivity_estimator::operator()(none) const {
+  return 0.0;
+}
+
+double selectivity_estimator::operator()(conjunction const& c) const {
+  auto result = 1.0;
+  for (auto& op : c)
+    result *= visit(*this, op);
+  return result;
+}
+
+double selectivity_estimator::operator()(disjunction const& d) const {
+  auto misses = 1.0;
+  for (auto& op : d)
+    misses *= 1.0 - visit(*this, op);
+  return 1.0 - misses;
+}
+
+double selectivity_estimator::operator()(negation const& n) const {
+  return 1.0 - visit(*this, n.expr());
+}
+
+double selectivity_estimator::operator()(predicate const& p) const {
+  auto rhs = get_if<data>(p.rhs);
+  if (rhs && statistics_)
+    if (auto stats = statistics_(p))
+      return stats->selectivity(p.op, *rhs);
+  return 1.0; // Without statistics, we must assume the worst.
+}
+
+query_planner::query_planner(selectivity_estimator::statistics_function f)
+  : estimator_{std::move(f)} {
+}
+
+expression query_planner::operator()(none) const {
+  return expression{};
+}
+
+expression query_planner::operator()(conjunction const& c) const {
+  std::vector<std::pair<double, expression>> ops;
+  for (auto& op : c) {
+    auto planned = visit(*this, op);
+    auto selectivity = visit(estimator_, planned);
+    ops.emplace_back(selectivity, std::move(planned));
+  }
+  std::stable_sort(ops.begin(), ops.end(),
+                   [](auto& x, auto& y) { return x.first < y.first; });
+  conjunction result;
+  for (auto& op : ops)
+    result.push_back(std::move(op.second));
+  return result;
+}
+
+expression query_planner::operator()(disjunction const& d) const {
+  std::vector<std::pair<double, expression>> ops;
+  for (auto& op : d) {
+    auto planned = visit(*this, op);
+    auto selectivity = visit(estimator_, planned);
+    ops.emplace_back(selectivity, std::move(planned));
+  }
+  std::stable_sort(ops.begin(), ops.end(),
+                   [](auto& x, auto& y) { return x.first > y.first; });
+  disjunction result;
+  for (auto& op : ops)
+    result.push_back(std::move(op.second));
+  return result;
+}
+
+expression query_planner::operator()(negation const& n) const {
+  return negation{visit(*this, n.expr())};
+}
+
+expression query_planner::operator()(predicate const& p) const {
+  return p;
+}
+
+bitmap_evaluator::bitmap_evaluator(lookup_function f,
+                                   bitmap const* restriction)
+  : lookup_{std::move(f)},
+    restriction_{restriction} {
+}
+
+expected<bitmap> bitmap_evaluator::operator()(none) const {
+  return bitmap{};
+}
+
+expected<bitmap> bitmap_evaluator::operator()(conjunction const& c) const {
+  bitmap hits;
+  auto restriction = restriction_;
+  for (auto& op : c) {
+    auto x = visit(bitmap_evaluator{lookup_, restriction}, op);
+    if (!x)
+      return x;
+    if (restriction)
+      *x = *x & *restriction;
+    hits = std::move(*x);
+    if (all<0>(hits))
+      return bitmap{}; // No need to look at the remaining operands.
+    restriction = &hits;
+  }
+  return hits;
+}
+
+expected<bitmap> bitmap_evaluator::operator()(disjunction const& d) const {
+  bitmap hits;
+  for (auto& op : d) {
+    auto x = visit(*this, op);
+    if (!x)
+      return x;
+    hits |= *x;
+    if (restriction_ && hits == *restriction_)
+      break; // Every possible hit matches already.
+  }
+  return hits;
+}
+
+expected<bitmap> bitmap_evaluator::operator()(negation const& n) const {
+  // Within the restriction, the complement of the operand's restricted hits
+  // equals the complement of all its hits, so the operand may skip the
+  // events outside the restriction as well.
+  auto x = visit(*this, n.expr());
+  if (!x)
+    return x;
+  x->flip();
+  if (restriction_)
+    *x = *x & *restriction_;
+  return x;
+}
+
+expected<bitmap> bitmap_evaluator::operator()(predicate const& p) const {
+  auto x = lookup_(p, restriction_);
+  if (x && restriction_)
+    *x = *x & *restriction_;
+  return x;
+}
+
 } // namespace vast
@@ -1,5 +1,6 @@
 #include <fstream>
 #include <iterator>
+#include <utility>
 
 #include <caf/streambuf.hpp>
 
@@ -17,6 +18,7 @@
 #  include <cstdio>
 #  include <fcntl.h>
 #  include <unistd.h>
+#  include <sys/mman.h>
 #  include <sys/stat.h>
 #  include <sys/types.h>
 #  define VAST_CHDIR(P)(::chdir(P) == 0)
@@ -294,10 +296,26 @@ bool file::read(void* sink, size_t bytes, size_t* got) {
   return is_open_ && detail::read(handle_, sink, bytes, got);
 }
 
+bool file::read_at(void* sink, size_t bytes, uint64_t offset) {
+  return is_open_ && detail::pread(handle_, sink, bytes, offset);
+}
+
+bool file::size(size_t& size) const {
+  return is_open_ && detail::file_size(handle_, size);
+}
+
 bool file::write(void const* source, size_t bytes, size_t* put) {
   return is_open_ && detail::write(handle_, source, bytes, put);
 }
 
+bool file::truncate(uint64_t size) {
+  return is_open_ && detail::truncate(handle_, size);
+}
+
+bool file::sync() {
+  return is_open_ && detail::fsync(handle_);
+}
+
 bool file::seek(size_t bytes) {
   if (!is_open_ || seek_failed_)
     return false;
@@ -316,6 +334,100 @@ file::native_type file::handle() const {
   return handle_;
 }
 
+mapped_file::mapped_file(mapped_file&& other)
+  : data_{other.data_},
+    size_{other.size_},
+    is_open_{other.is_open_} {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.is_open_ = false;
+}
+
+mapped_file::~mapped_file() {
+  close();
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) {
+  if (this != &other) {
+    close();
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(is_open_, other.is_open_);
+  }
+  return *this;
+}
+
+maybe<void> mapped_file::open(vast::path const& p, access_pattern pattern) {
+  if (is_open_)
+    return fail<ec::filesystem_error>("file already mapped");
+#ifdef VAST_POSIX
+  file f{p};
+  auto m = f.open(file::read_only);
+  if (!m)
+    return m;
+  if (!detail::file_size(f.handle(), size_))
+    return fail<ec::filesystem_error>(std::strerror(errno), p);
+  // An empty file has no mapping but remains readable.
+  if (size_ > 0) {
+    data_ = reinterpret_cast<char*>(detail::map(f.handle(), size_));
+    if (data_ == nullptr)
+      return fail<ec::filesystem_error>(std::strerror(errno), p);
+  }
+  // The mapping outlives the file descriptor.
+  is_open_ = true;
+  advise(pattern);
+  return {};
+#else
+  return fail<ec::filesystem_error>("not yet implemented");
+#endif // VAST_POSIX
+}
+
+bool mapped_file::close() {
+  if (!is_open_)
+    return false;
+#ifdef VAST_POSIX
+  if (data_ != nullptr && !detail::unmap(data_, size_))
+    return false;
+#endif // VAST_POSIX
+  data_ = nullptr;
+  size_ = 0;
+  is_open_ = false;
+  return true;
+}
+
+bool mapped_file::is_open() const {
+  return is_open_;
+}
+
+bool mapped_file::advise(access_pattern pattern) {
+  if (data_ == nullptr)
+    return is_open_;
+#ifdef VAST_POSIX
+  auto advice = MADV_NORMAL;
+  switch (pattern) {
+    case normal:
+      break;
+    case sequential:
+      advice = MADV_SEQUENTIAL;
+      break;
+    case random:
+      advice = MADV_RANDOM;
+      break;
+  }
+  return detail::advise(data_, size_, advice);
+#else
+  return false;
+#endif // VAST_POSIX
+}
+
+char const* mapped_file::data() const {
+  return data_;
+}
+
+size_t mapped_file::size() const {
+  return size_;
+}
+
 directory::iterator::iterator(directory* dir) : dir_{dir} {
   increment();
 }
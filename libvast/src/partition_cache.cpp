@@ -0,0 +1,104 @@
+#include "vast/error.hpp"
+#include "vast/partition_cache.hpp"
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/detail/assert.hpp"
+
+namespace vast {
+
+partition_cache::partition_cache(detail::thread_pool& pool, path dir,
+                                 size_t capacity, uint64_t max_bytes)
+  : pool_{pool},
+    dir_{std::move(dir)},
+    capacity_{capacity},
+    max_bytes_{max_bytes} {
+  VAST_ASSERT(capacity_ > 0);
+}
+
+expected<partition_indexer*> partition_cache::get(uuid const& id) {
+  auto i = partitions_.find(id);
+  if (i != partitions_.end()) {
+    policy_.access(i->second.position);
+    return i->second.indexer.get();
+  }
+  auto p = dir_ / to_string(id);
+  if (!exists(p))
+    return fail<ec::filesystem_error>("no such partition", p);
+  auto indexer = std::make_unique<partition_indexer>(pool_, p);
+  auto m = indexer->load();
+  if (!m)
+    return m.error();
+  auto& e = partitions_[id];
+  e.indexer = std::move(indexer);
+  e.position = policy_.insert(id);
+  measure(e);
+  shrink(id);
+  return e.indexer.get();
+}
+
+expected<bitmap> partition_cache::lookup(uuid const& id, predicate const& p) {
+  auto indexer = get(id);
+  if (!indexer)
+    return indexer.error();
+  auto result = (*indexer)->lookup(p);
+  // The lookup may have materialized another column.
+  measure(partitions_[id]);
+  shrink(id);
+  return result;
+}
+
+bool partition_cache::pin(uuid const& id) {
+  auto i = partitions_.find(id);
+  if (i == partitions_.end())
+    return false;
+  ++i->second.pins;
+  return true;
+}
+
+void partition_cache::unpin(uuid const& id) {
+  auto i = partitions_.find(id);
+  VAST_ASSERT(i != partitions_.end());
+  VAST_ASSERT(i->second.pins > 0);
+  if (--i->second.pins == 0)
+    shrink(uuid::nil());
+}
+
+size_t partition_cache::erase(uuid const& id) {
+  auto i = partitions_.find(id);
+  if (i == partitions_.end())
+    return 0;
+  policy_.erase(i->second.position);
+  bytes_ -= i->second.bytes;
+  partitions_.erase(i);
+  return 1;
+}
+
+size_t partition_cache::size() const {
+  return partitions_.size();
+}
+
+uint64_t partition_cache::memusage() const {
+  return bytes_;
+}
+
+void partition_cache::measure(entry& e) {
+  auto bytes = static_cast<uint64_t>(e.indexer->memusage());
+  bytes_ = bytes_ - e.bytes + bytes;
+  e.bytes = bytes;
+}
+
+void partition_cache::shrink(uuid const& keep) {
+  auto exceeded = [&] {
+    return partitions_.size() > capacity_
+           || (max_bytes_ > 0 && bytes_ > max_bytes_);
+  };
+  auto i = policy_.begin();
+  while (exceeded() && i != policy_.end()) {
+    auto id = *i++;
+    auto& e = partitions_[id];
+    if (id != keep && e.pins == 0)
+      erase(id);
+  }
+}
+
+} // namespace vast
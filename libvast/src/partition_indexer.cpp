@@ -0,0 +1,580 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <iterator>
+#include <numeric>
+
+#include <caf/streambuf.hpp>
+
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/error.hpp"
+#include "vast/expression_visitors.hpp"
+#include "vast/load.hpp"
+#include "vast/partition_indexer.hpp"
+#include "vast/save.hpp"
+#include "vast/detail/byte_swap.hpp"
+#include "vast/detail/thread_pool.hpp"
+
+namespace vast {
+namespace {
+
+// Identifies a sealed partition index ("VASTIDX2").
+constexpr uint64_t magic = 0x5641535449445832;
+
+// The size of the footer: the position of the header plus the magic number.
+constexpr size_t footer_size = 2 * sizeof(uint64_t);
+
+void put_uint64(std::vector<char>& buf, uint64_t x) {
+  x = detail::to_network_order(x);
+  auto ptr = reinterpret_cast<char const*>(&x);
+  buf.insert(buf.end(), ptr, ptr + sizeof(x));
+}
+
+uint64_t get_uint64(char const* ptr) {
+  uint64_t x;
+  std::memcpy(&x, ptr, sizeof(x));
+  return detail::to_host_order(x);
+}
+
+bool skipped(type const& t) {
+  for (auto& attr : t.attributes())
+    if (attr.key == "skip")
+      return true;
+  return false;
+}
+
+// The values of a column in a log record.
+struct column_delta {
+  uint64_t column;
+  std::vector<data> values;
+  std::vector<event_id> ids;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, column_delta& x) {
+    return f(x.column, x.values, x.ids);
+  }
+};
+
+// A record in the log.
+struct delta {
+  std::vector<data_extractor> added; // New data columns in order of creation.
+  std::vector<column_delta> columns;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, delta& x) {
+    return f(x.added, x.columns);
+  }
+};
+
+// Replaces a file atomically with the contents of a buffer. The contents
+// reach the disk before the rename, so that a crash leaves either the old or
+// the new file behind, but never an empty one.
+maybe<void> replace(path const& filename, std::vector<char> const& buf) {
+  auto tmp = path{filename.str() + ".tmp"};
+  if (exists(tmp))
+    rm(tmp);
+  file f{tmp};
+  auto m = f.open(file::write_only);
+  if (!m)
+    return m;
+  if (!f.write(buf.data(), buf.size()) || !f.sync() || !f.close())
+    return fail<ec::filesystem_error>("failed to write", tmp);
+  if (std::rename(tmp.str().c_str(), filename.str().c_str()) != 0)
+    return fail<ec::filesystem_error>("failed to rename", tmp);
+  return {};
+}
+
+// Sorts the staged values of a column by their IDs.
+void sort_staged(std::vector<data>& values, std::vector<event_id>& ids) {
+  if (std::is_sorted(ids.begin(), ids.end()))
+    return;
+  std::vector<size_t> order(ids.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](size_t x, size_t y) { return ids[x] < ids[y]; });
+  std::vector<data> xs;
+  std::vector<event_id> ys;
+  xs.reserve(values.size());
+  ys.reserve(ids.size());
+  for (auto i : order) {
+    xs.push_back(std::move(values[i]));
+    ys.push_back(ids[i]);
+  }
+  values.swap(xs);
+  ids.swap(ys);
+}
+
+} // namespace <anonymous>
+
+partition_indexer::partition_indexer(detail::thread_pool& pool, path dir)
+  : pool_{pool},
+    dir_{std::move(dir)} {
+  name_.type = string_type{};
+  name_.index = value_index::make(name_.type);
+  time_.type = timestamp_type{};
+  time_.index = value_index::make(time_.type);
+}
+
+maybe<void> partition_indexer::add(batch const& b) {
+  auto first = b.id_range().first;
+  if (first == invalid_event_id)
+    return fail("batch lacks event IDs");
+  auto m = check_first(first);
+  if (!m)
+    return m;
+  // Take the values straight from the columns of each table.
+  std::vector<column*> staged;
+  auto stage = [&](column& c, data&& x, event_id id) {
+    if (c.ids.empty())
+      staged.push_back(&c);
+    c.values.push_back(std::move(x));
+    c.ids.push_back(id);
+  };
+  auto f = [&](type const& t, bool columnar, std::vector<event_id> const& ids,
+               vector& timestamps, std::vector<vector>& columns) {
+    for (auto i = 0u; i < ids.size(); ++i) {
+      stage(name_, t.name(), ids[i]);
+      stage(time_, std::move(timestamps[i]), ids[i]);
+    }
+    for (auto& field : layout(t)) {
+      for (auto i = 0u; i < ids.size(); ++i) {
+        if (columnar) {
+          auto& x = columns[field.leaf][i];
+          if (!is<none>(x))
+            stage(*field.col, std::move(x), ids[i]);
+        } else {
+          auto& y = columns[0][i];
+          auto x = field.offset.empty() ? &y : get(y, field.offset);
+          if (x && !is<none>(*x))
+            stage(*field.col, data{*x}, ids[i]);
+        }
+      }
+    }
+  };
+  if (auto err = batch::reader{b}.read_columns(f)) {
+    for (auto c : staged) {
+      c->values.clear();
+      c->ids.clear();
+    }
+    return err;
+  }
+  // The tables of different event types interleave their IDs.
+  for (auto c : staged)
+    sort_staged(c->values, c->ids);
+  return index(staged);
+}
+
+maybe<void> partition_indexer::add(std::vector<event> const& events) {
+  // Validate all IDs before touching any column.
+  auto last = invalid_event_id;
+  for (auto& e : events) {
+    if (e.id() == invalid_event_id)
+      continue;
+    if (last == invalid_event_id) {
+      auto m = check_first(e.id());
+      if (!m)
+        return m;
+    } else if (e.id() <= last) {
+      return fail("event IDs out of order");
+    }
+    last = e.id();
+  }
+  // Split the events into columns, remembering each column with new values.
+  std::vector<column*> staged;
+  auto stage = [&](column& c, data const& x, event_id id) {
+    if (c.ids.empty())
+      staged.push_back(&c);
+    c.values.push_back(x);
+    c.ids.push_back(id);
+  };
+  for (auto& e : events) {
+    if (e.id() == invalid_event_id)
+      continue;
+    stage(name_, e.type().name(), e.id());
+    stage(time_, e.timestamp(), e.id());
+    for (auto& field : layout(e.type())) {
+      auto x = field.offset.empty() ? &e.data() : get(e.data(), field.offset);
+      // Value indexes do not accept nil, so absent values stay unindexed.
+      if (x && !is<none>(*x))
+        stage(*field.col, *x, e.id());
+    }
+  }
+  return index(staged);
+}
+
+maybe<void> partition_indexer::index(std::vector<column*> const& staged) {
+  // Index all columns in parallel. Each task owns its column exclusively.
+  auto persistent = !dir_.empty();
+  std::vector<std::future<bool>> results;
+  results.reserve(staged.size());
+  for (auto c : staged)
+    results.push_back(pool_.submit([=] {
+      auto result = materialize(*c) && c->index->append(c->values, c->ids);
+      if (result)
+        for (auto& x : c->values)
+          c->statistics.add(x);
+      if (result && persistent) {
+        std::move(c->values.begin(), c->values.end(),
+                  std::back_inserter(c->unflushed_values));
+        c->unflushed_ids.insert(c->unflushed_ids.end(), c->ids.begin(),
+                                c->ids.end());
+      }
+      c->values.clear();
+      c->ids.clear();
+      return result;
+    }));
+  // We must wait for all tasks, even after a failure, because they access
+  // our columns.
+  auto failures = 0u;
+  for (auto& r : results)
+    if (!r.get())
+      ++failures;
+  if (failures > 0)
+    return fail("failed to append", failures, "columns");
+  return {};
+}
+
+maybe<void> partition_indexer::load() {
+  VAST_ASSERT(!dir_.empty());
+  auto filename = dir_ / "index";
+  if (exists(filename)) {
+    auto malformed = [&] {
+      return fail<ec::parse_error>("malformed partition index", filename);
+    };
+    auto m = sealed_.open(filename, mapped_file::random);
+    if (!m)
+      return m;
+    // Read only the footer and the header. The kernel faults in the pages
+    // of a value index once we deserialize it.
+    auto bytes = sealed_.data();
+    auto size = sealed_.size();
+    if (size < footer_size
+        || get_uint64(bytes + size - sizeof(uint64_t)) != magic)
+      return malformed();
+    auto header = get_uint64(bytes + size - footer_size);
+    if (header > size - footer_size)
+      return malformed();
+    caf::charbuf buf{const_cast<char*>(bytes + header),
+                     size - footer_size - header};
+    std::vector<data_extractor> keys;
+    std::vector<uint64_t> offsets;
+    std::vector<column_statistics> statistics;
+    m = vast::load(buf, keys, offsets, statistics);
+    if (!m)
+      return m;
+    if (offsets.size() != keys.size() + 3
+        || statistics.size() != keys.size() + 2
+        || !std::is_sorted(offsets.begin(), offsets.end())
+        || offsets.back() > header)
+      return malformed();
+    for (auto& key : keys)
+      if (!make_column(key))
+        return malformed();
+    for (auto i = 0u; i < 2 + order_.size(); ++i) {
+      auto c = at(i);
+      c->index.reset();
+      c->offset = offsets[i];
+      c->size = offsets[i + 1] - offsets[i];
+      c->statistics = std::move(statistics[i]);
+    }
+    flushed_columns_ = order_.size();
+  }
+  return replay();
+}
+
+maybe<void> partition_indexer::flush() {
+  VAST_ASSERT(!dir_.empty());
+  delta x;
+  for (auto i = flushed_columns_; i < order_.size(); ++i)
+    x.added.push_back(order_[i]->first);
+  for (auto i = 0u; i < 2 + order_.size(); ++i) {
+    auto c = at(i);
+    if (!c->unflushed_ids.empty())
+      x.columns.push_back({i, c->unflushed_values, c->unflushed_ids});
+  }
+  if (x.added.empty() && x.columns.empty())
+    return {};
+  std::vector<char> buf(sizeof(uint32_t));
+  auto m = save(buf, x);
+  if (!m)
+    return m;
+  auto size = detail::to_network_order(
+    static_cast<uint32_t>(buf.size() - sizeof(uint32_t)));
+  std::memcpy(buf.data(), &size, sizeof(size));
+  // We write at the end of the valid part of the log, which overwrites the
+  // remains of a previous flush that never updated the manifest. The record
+  // must reach the disk before the manifest covers it.
+  auto filename = dir_ / "log";
+  file f{filename};
+  m = f.open(file::write_only);
+  if (!m)
+    return m;
+  if (!f.seek(log_size_) || !f.write(buf.data(), buf.size()) || !f.sync()
+      || !f.close())
+    return fail<ec::filesystem_error>("failed to append to", filename);
+  std::vector<char> manifest;
+  auto log_size = log_size_ + buf.size();
+  m = save(manifest, log_size);
+  if (!m)
+    return m;
+  m = replace(dir_ / "manifest", manifest);
+  if (!m)
+    return m;
+  log_size_ = log_size;
+  flushed_columns_ = order_.size();
+  for (auto i = 0u; i < 2 + order_.size(); ++i) {
+    auto c = at(i);
+    c->unflushed_values.clear();
+    c->unflushed_ids.clear();
+  }
+  return {};
+}
+
+maybe<void> partition_indexer::seal() {
+  VAST_ASSERT(!dir_.empty());
+  std::vector<char> buf;
+  std::vector<uint64_t> offsets;
+  std::vector<column_statistics> statistics;
+  for (auto i = 0u; i < 2 + order_.size(); ++i) {
+    auto c = at(i);
+    auto m = materialize(*c);
+    if (!m)
+      return m;
+    statistics.push_back(c->statistics);
+    offsets.push_back(buf.size());
+    detail::value_index_inspect_helper helper{c->type, c->index};
+    m = save(buf, helper);
+    if (!m)
+      return m;
+  }
+  offsets.push_back(buf.size());
+  std::vector<data_extractor> keys;
+  for (auto i : order_)
+    keys.push_back(i->first);
+  auto header = buf.size();
+  auto m = save(buf, keys, offsets, statistics);
+  if (!m)
+    return m;
+  put_uint64(buf, header);
+  put_uint64(buf, magic);
+  m = replace(dir_ / "index", buf);
+  if (!m)
+    return m;
+  // All value indexes reside in memory now.
+  sealed_.close();
+  // If we crash before removing the log, the next replay skips its values
+  // because the sealed indexes already contain them.
+  rm(dir_ / "manifest");
+  rm(dir_ / "log");
+  log_size_ = 0;
+  flushed_columns_ = order_.size();
+  for (auto i = 0u; i < 2 + order_.size(); ++i) {
+    auto c = at(i);
+    c->unflushed_values.clear();
+    c->unflushed_ids.clear();
+  }
+  return {};
+}
+
+expected<bitmap> partition_indexer::lookup(predicate const& p,
+                                           bitmap const* restriction) {
+  auto x = get_if<data>(p.rhs);
+  if (!x)
+    return fail("predicate without data on the right-hand side");
+  auto c = find(p);
+  if (!c)
+    return c.error();
+  // Without candidates, we need not load the value index.
+  if (!*c || (restriction && all<0>(*restriction)))
+    return bitmap{};
+  auto m = materialize(**c);
+  if (!m)
+    return m.error();
+  auto result = (*c)->index->lookup(p.op, *x);
+  if (!result)
+    return result.error();
+  if (restriction)
+    *result = *result & *restriction;
+  return std::move(*result);
+}
+
+expected<bitmap> partition_indexer::lookup(expression const& expr) {
+  auto stats = [&](predicate const& p) { return statistics(p); };
+  auto plan = visit(query_planner{stats}, expr);
+  auto f = [&](predicate const& p, bitmap const* restriction) {
+    return lookup(p, restriction);
+  };
+  return visit(bitmap_evaluator{f}, plan);
+}
+
+column_statistics const*
+partition_indexer::statistics(predicate const& p) {
+  auto c = find(p);
+  return c && *c ? &(*c)->statistics : nullptr;
+}
+
+size_t partition_indexer::columns() const {
+  return 2 + data_.size();
+}
+
+size_t partition_indexer::resident_columns() const {
+  auto result = size_t{0};
+  auto count = [&](column const& c) {
+    if (c.index)
+      ++result;
+  };
+  count(name_);
+  count(time_);
+  for (auto& pair : data_)
+    count(pair.second);
+  return result;
+}
+
+size_t partition_indexer::memusage() const {
+  auto result = size_t{0};
+  auto accumulate = [&](column const& c) {
+    if (c.index)
+      result += c.index->memusage();
+  };
+  accumulate(name_);
+  accumulate(time_);
+  for (auto& pair : data_)
+    accumulate(pair.second);
+  return result;
+}
+
+partition_indexer::layout_type const&
+partition_indexer::layout(type const& t) {
+  auto i = layouts_.find(t);
+  if (i != layouts_.end())
+    return i->second;
+  layout_type result;
+  if (auto r = get_if<record_type>(t)) {
+    auto leaf = size_t{0};
+    for (auto& f : record_type::each{*r}) {
+      if (auto c = make_column(data_extractor{t, f.offset}))
+        result.push_back({f.offset, leaf, c});
+      ++leaf;
+    }
+  } else if (auto c = make_column(data_extractor{t, {}})) {
+    result.push_back({offset{}, 0, c});
+  }
+  return layouts_.emplace(t, std::move(result)).first->second;
+}
+
+partition_indexer::column*
+partition_indexer::make_column(data_extractor const& key) {
+  auto i = data_.find(key);
+  if (i != data_.end())
+    return &i->second;
+  auto r = get_if<record_type>(key.type);
+  auto t = r ? r->at(key.offset) : &key.type;
+  if (!t || skipped(*t))
+    return nullptr;
+  auto idx = value_index::make(*t);
+  if (!idx)
+    return nullptr;
+  i = data_.emplace(key, column{}).first;
+  i->second.type = *t;
+  i->second.index = std::move(idx);
+  order_.push_back(i);
+  return &i->second;
+}
+
+maybe<void> partition_indexer::materialize(column& c) const {
+  if (c.index)
+    return {};
+  VAST_ASSERT(sealed_.is_open());
+  caf::charbuf buf{const_cast<char*>(sealed_.data() + c.offset), c.size};
+  detail::value_index_inspect_helper helper{c.type, c.index};
+  return vast::load(buf, helper);
+}
+
+expected<partition_indexer::column*>
+partition_indexer::find(predicate const& p) {
+  if (auto a = get_if<attribute_extractor>(p.lhs)) {
+    if (a->attr == "type")
+      return &name_;
+    if (a->attr == "time")
+      return &time_;
+    return fail("unsupported attribute", a->attr);
+  }
+  if (auto e = get_if<data_extractor>(p.lhs)) {
+    auto i = data_.find(*e);
+    return i == data_.end() ? nullptr : &i->second;
+  }
+  return fail("predicate without extractor on the left-hand side");
+}
+
+maybe<void> partition_indexer::check_first(event_id first) {
+  auto m = materialize(name_);
+  if (!m)
+    return m;
+  if (first < name_.index->offset())
+    return fail("event IDs out of order");
+  return {};
+}
+
+partition_indexer::column* partition_indexer::at(size_t i) {
+  if (i == 0)
+    return &name_;
+  if (i == 1)
+    return &time_;
+  return i - 2 < order_.size() ? &order_[i - 2]->second : nullptr;
+}
+
+maybe<void> partition_indexer::replay() {
+  if (!exists(dir_ / "manifest"))
+    return {};
+  auto m = vast::load(dir_ / "manifest", log_size_);
+  if (!m)
+    return m;
+  auto contents = load_contents(dir_ / "log");
+  if (!contents)
+    return contents.error();
+  if (contents->size() < log_size_)
+    return fail<ec::parse_error>("log smaller than its manifest");
+  auto ptr = contents->data();
+  auto end = ptr + log_size_;
+  while (ptr != end) {
+    uint32_t size;
+    if (static_cast<size_t>(end - ptr) < sizeof(size))
+      return fail<ec::parse_error>("truncated log record");
+    std::memcpy(&size, ptr, sizeof(size));
+    size = detail::to_host_order(size);
+    ptr += sizeof(size);
+    if (static_cast<size_t>(end - ptr) < size)
+      return fail<ec::parse_error>("truncated log record");
+    delta x;
+    m = vast::load(std::vector<char>(ptr, ptr + size), x);
+    if (!m)
+      return m;
+    ptr += size;
+    for (auto& key : x.added)
+      if (!make_column(key))
+        return fail<ec::parse_error>("invalid column in log");
+    for (auto& cd : x.columns) {
+      auto c = at(cd.column);
+      if (!c)
+        return fail<ec::parse_error>("invalid column in log");
+      m = materialize(*c);
+      if (!m)
+        return m;
+      // Skip the values that the sealed indexes already contain.
+      auto off = c->index->offset();
+      auto first = std::lower_bound(cd.ids.begin(), cd.ids.end(), off);
+      auto n = first - cd.ids.begin();
+      cd.values.erase(cd.values.begin(), cd.values.begin() + n);
+      cd.ids.erase(cd.ids.begin(), first);
+      if (!c->index->append(cd.values, cd.ids))
+        return fail("failed to replay log");
+      for (auto& x : cd.values)
+        c->statistics.add(x);
+    }
+  }
+  flushed_columns_ = order_.size();
+  return {};
+}
+
+} // namespace vast
@@ -0,0 +1,100 @@
+#include <algorithm>
+
+#include "vast/partition_scheduler.hpp"
+#include "vast/detail/assert.hpp"
+
+namespace vast {
+
+partition_scheduler::partition_scheduler(size_t capacity)
+  : capacity_{capacity} {
+  VAST_ASSERT(capacity_ > 0);
+}
+
+bool partition_scheduler::add(uuid const& query, int priority, order o,
+                              std::vector<candidate> partitions) {
+  if (queries_.count(query) > 0)
+    return false;
+  if (partitions.empty())
+    return true;
+  // The next partition goes last, so that taking it is cheap.
+  std::sort(partitions.begin(), partitions.end(),
+            [=](candidate const& x, candidate const& y) {
+              return o == order::newest_first ? x.latest < y.latest
+                                              : y.latest < x.latest;
+            });
+  auto& q = queries_[query];
+  q.partitions.reserve(partitions.size());
+  for (auto& p : partitions)
+    q.partitions.push_back(p.id);
+  pending_ += partitions.size();
+  // A new query starts with as many evaluations as the least served query of
+  // the same priority.
+  auto level = -static_cast<int64_t>(priority);
+  auto served = uint64_t{0};
+  auto i = ready_.lower_bound(ready_key{level, 0, 0});
+  if (i != ready_.end() && std::get<0>(i->first) == level)
+    served = std::get<1>(i->first);
+  q.key = ready_key{level, served, arrivals_++};
+  ready_.emplace(q.key, query);
+  return true;
+}
+
+optional<partition_scheduler::task> partition_scheduler::next() {
+  if (running_ >= capacity_ || ready_.empty())
+    return {};
+  auto i = ready_.begin();
+  auto query = i->second;
+  ready_.erase(i);
+  auto& q = queries_[query];
+  VAST_ASSERT(!q.partitions.empty());
+  auto result = task{query, q.partitions.back()};
+  q.partitions.pop_back();
+  ++q.running;
+  ++running_;
+  --pending_;
+  if (!q.partitions.empty()) {
+    ++std::get<1>(q.key);
+    ready_.emplace(q.key, query);
+  }
+  return result;
+}
+
+bool partition_scheduler::complete(task const& t) {
+  auto i = queries_.find(t.query);
+  VAST_ASSERT(i != queries_.end());
+  VAST_ASSERT(i->second.running > 0);
+  --running_;
+  if (--i->second.running > 0 || !i->second.partitions.empty())
+    return false;
+  queries_.erase(i);
+  return true;
+}
+
+size_t partition_scheduler::cancel(uuid const& query) {
+  auto i = queries_.find(query);
+  if (i == queries_.end())
+    return 0;
+  auto result = i->second.partitions.size();
+  if (result > 0)
+    ready_.erase(i->second.key);
+  pending_ -= result;
+  if (i->second.running == 0)
+    queries_.erase(i);
+  else
+    i->second.partitions.clear();
+  return result;
+}
+
+size_t partition_scheduler::capacity() const {
+  return capacity_;
+}
+
+size_t partition_scheduler::running() const {
+  return running_;
+}
+
+size_t partition_scheduler::pending() const {
+  return pending_;
+}
+
+} // namespace vast
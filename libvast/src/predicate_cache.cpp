@@ -0,0 +1,65 @@
+#include <algorithm>
+
+#include "vast/predicate_cache.hpp"
+#include "vast/save.hpp"
+
+namespace vast {
+
+predicate_cache::predicate_cache(size_t capacity) : cache_{capacity} {
+  cache_.on_evict([&](std::string const& key, bitmap&) {
+    // The key starts with the bytes of the partition ID.
+    uuid partition;
+    std::copy_n(key.begin(), partition.size(), partition.begin());
+    auto i = keys_.find(partition);
+    if (i == keys_.end())
+      return;
+    auto& xs = i->second;
+    xs.erase(std::find(xs.begin(), xs.end(), key));
+    if (xs.empty())
+      keys_.erase(i);
+  });
+}
+
+size_t predicate_cache::erase(uuid const& partition) {
+  auto i = keys_.find(partition);
+  if (i == keys_.end())
+    return 0;
+  for (auto& key : i->second)
+    cache_.erase(key);
+  auto result = i->second.size();
+  keys_.erase(i);
+  return result;
+}
+
+uint64_t predicate_cache::hits() const {
+  return hits_;
+}
+
+uint64_t predicate_cache::misses() const {
+  return misses_;
+}
+
+size_t predicate_cache::size() const {
+  return cache_.size();
+}
+
+size_t predicate_cache::bytes() const {
+  return cache_.weight();
+}
+
+std::string predicate_cache::make_key(uuid const& partition,
+                                      predicate const& p) {
+  std::vector<char> buf;
+  save(buf, p);
+  std::string result(partition.begin(), partition.end());
+  result.append(buf.begin(), buf.end());
+  return result;
+}
+
+void predicate_cache::insert(uuid const& partition, std::string key,
+                             bitmap hits) {
+  if (cache_.insert(key, std::move(hits)).second)
+    keys_[partition].push_back(std::move(key));
+}
+
+} // namespace vast
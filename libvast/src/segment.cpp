@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+#include <caf/streambuf.hpp>
+
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/error.hpp"
+#include "vast/load.hpp"
+#include "vast/save.hpp"
+#include "vast/segment.hpp"
+#include "vast/detail/byte_swap.hpp"
+#include "vast/detail/thread_pool.hpp"
+#include "vast/detail/varbyte.hpp"
+
+namespace vast {
+namespace {
+
+// Identifies a segment file with index ("VASTSEG1").
+constexpr uint64_t magic = 0x5641535453454731;
+
+// The size of the footer: the position of the index plus the magic number.
+constexpr size_t footer_size = 2 * sizeof(uint64_t);
+
+// The size of a record in the index.
+constexpr size_t record_size = 4 * sizeof(uint64_t);
+
+bool write_varbyte(file& f, uint64_t x, uint64_t& offset) {
+  char buf[detail::varbyte::max_size<uint64_t>()];
+  auto n = detail::varbyte::encode(x, buf);
+  offset += n;
+  return f.write(buf, n);
+}
+
+void put_uint64(std::vector<char>& buf, uint64_t x) {
+  x = detail::to_network_order(x);
+  auto ptr = reinterpret_cast<char const*>(&x);
+  buf.insert(buf.end(), ptr, ptr + sizeof(x));
+}
+
+uint64_t get_uint64(char const* ptr) {
+  uint64_t x;
+  std::memcpy(&x, ptr, sizeof(x));
+  return detail::to_host_order(x);
+}
+
+// Parses an entry, yielding the event IDs and the bytes of the batch.
+bool parse_entry(char const*& ptr, char const* end, bitmap& ids,
+                 char const*& bytes, uint64_t& size) {
+  if (!detail::varbyte::decode(size, ptr, end)
+      || size > static_cast<size_t>(end - ptr))
+    return false;
+  caf::charbuf buf{const_cast<char*>(ptr), size};
+  ids = bitmap{};
+  load(buf, ids);
+  ptr += size;
+  if (!detail::varbyte::decode(size, ptr, end)
+      || size > static_cast<size_t>(end - ptr))
+    return false;
+  bytes = ptr;
+  ptr += size;
+  return true;
+}
+
+// Determines the end of the entries in a segment file, which is the
+// position of the index if the file has a footer.
+size_t entries_end(char const* data, size_t size) {
+  if (size < footer_size)
+    return size;
+  auto footer = data + size - footer_size;
+  auto offset = get_uint64(footer);
+  if (get_uint64(footer + sizeof(uint64_t)) != magic
+      || offset > size - footer_size)
+    return size;
+  return offset;
+}
+
+std::pair<event_id, event_id> id_range(bitmap const& ids) {
+  auto n = ids.empty() ? 0 : rank(ids);
+  if (n == 0)
+    return {invalid_event_id, invalid_event_id};
+  return {select(ids, 1), select(ids, n)};
+}
+
+} // namespace <anonymous>
+
+maybe<void> segment::write(path const& filename,
+                           std::vector<batch> const& batches) {
+  // Opening a file for writing does not truncate it.
+  if (exists(filename) && !rm(filename))
+    return fail<ec::filesystem_error>("failed to remove", filename);
+  file f{filename};
+  auto m = f.open(file::write_only);
+  if (!m)
+    return m;
+  auto failure = [&] {
+    return fail<ec::filesystem_error>("failed to write segment", filename);
+  };
+  std::vector<char> ids;
+  std::vector<char> index;
+  auto offset = uint64_t{0};
+  for (auto& b : batches) {
+    ids.clear();
+    auto bm = b.ids();
+    save(ids, bm);
+    auto range = b.id_range();
+    put_uint64(index, range.first);
+    put_uint64(index, range.second);
+    put_uint64(index, offset);
+    auto begin = offset;
+    if (!write_varbyte(f, ids.size(), offset)
+        || !f.write(ids.data(), ids.size())
+        || !write_varbyte(f, b.size(), offset)
+        || !f.write(b.bytes(), b.size()))
+      return failure();
+    offset += ids.size() + b.size();
+    put_uint64(index, offset - begin);
+  }
+  put_uint64(index, offset);
+  put_uint64(index, magic);
+  if (!f.write(index.data(), index.size()) || !f.sync())
+    return failure();
+  return {};
+}
+
+expected<segment> segment::map(path const& filename,
+                               mapped_file::access_pattern pattern) {
+  auto malformed = [] { return fail<ec::parse_error>("malformed segment"); };
+  auto mapping = std::make_shared<mapped_file>();
+  auto m = mapping->open(filename, pattern);
+  if (!m)
+    return m.error();
+  segment result;
+  auto ptr = mapping->data();
+  auto end = ptr + entries_end(ptr, mapping->size());
+  while (ptr != end) {
+    bitmap ids;
+    char const* bytes;
+    uint64_t size;
+    if (!parse_entry(ptr, end, ids, bytes, size))
+      return malformed();
+    auto b = batch::view(bytes, size, mapping);
+    if (!b)
+      return b.error();
+    if (!ids.empty() && !b->ids(std::move(ids)))
+      return malformed();
+    result.batches_.push_back(std::move(*b));
+  }
+  result.file_ = std::move(mapping);
+  return result;
+}
+
+std::vector<batch> const& segment::batches() const {
+  return batches_;
+}
+
+bool segment::advise(mapped_file::access_pattern pattern) {
+  return file_ && file_->advise(pattern);
+}
+
+segment::reader::reader(path filename) : file_{std::move(filename)} {
+}
+
+maybe<void> segment::reader::open() {
+  auto malformed = [] { return fail<ec::parse_error>("malformed segment"); };
+  auto m = file_.open(file::read_only);
+  if (!m)
+    return m;
+  size_t size;
+  if (!file_.size(size))
+    return fail<ec::filesystem_error>("failed to stat", file_.path());
+  index_.clear();
+  char footer[footer_size];
+  if (size >= footer_size
+      && file_.read_at(footer, footer_size, size - footer_size)
+      && get_uint64(footer + sizeof(uint64_t)) == magic) {
+    auto offset = get_uint64(footer);
+    if (offset > size - footer_size
+        || (size - footer_size - offset) % record_size != 0)
+      return malformed();
+    std::vector<char> buf(size - footer_size - offset);
+    if (!buf.empty() && !file_.read_at(buf.data(), buf.size(), offset))
+      return fail<ec::filesystem_error>("failed to read", file_.path());
+    for (auto ptr = buf.data(); ptr != buf.data() + buf.size();
+         ptr += record_size)
+      index_.push_back({get_uint64(ptr), get_uint64(ptr + 8),
+                        get_uint64(ptr + 16), get_uint64(ptr + 24)});
+  } else {
+    // Files without index require a full scan to reconstruct it.
+    std::vector<char> buf(size);
+    if (!buf.empty() && !file_.read_at(buf.data(), buf.size(), 0))
+      return fail<ec::filesystem_error>("failed to read", file_.path());
+    auto ptr = buf.data();
+    auto end = ptr + buf.size();
+    while (ptr != end) {
+      auto begin = ptr;
+      bitmap ids;
+      char const* bytes;
+      uint64_t n;
+      if (!parse_entry(ptr, end, ids, bytes, n))
+        return malformed();
+      auto range = id_range(ids);
+      index_.push_back({range.first, range.second,
+                        static_cast<uint64_t>(begin - buf.data()),
+                        static_cast<uint64_t>(ptr - begin)});
+    }
+  }
+  // Batches without event IDs never satisfy a lookup.
+  auto invalid = [](entry const& e) {
+    return e.first == invalid_event_id || e.first > e.last;
+  };
+  index_.erase(std::remove_if(index_.begin(), index_.end(), invalid),
+               index_.end());
+  std::sort(index_.begin(), index_.end(),
+            [](entry const& x, entry const& y) { return x.first < y.first; });
+  return {};
+}
+
+std::vector<segment::reader::entry> const& segment::reader::index() const {
+  return index_;
+}
+
+expected<batch> segment::reader::read(event_id id) {
+  auto i = find(id);
+  if (i == index_.end())
+    return fail("no batch with event", id);
+  return read(*i);
+}
+
+expected<std::vector<batch>> segment::reader::read(bitmap const& ids) {
+  std::vector<batch> result;
+  for (auto& e : entries(ids)) {
+    auto b = read(e);
+    if (!b)
+      return b.error();
+    result.push_back(std::move(*b));
+  }
+  return result;
+}
+
+error segment::reader::lookup(bitmap const& ids, detail::thread_pool& pool,
+                              consumer f, size_t window) {
+  using result_type = expected<std::vector<event>>;
+  // Split the IDs by batch in a single pass, so that each batch filters only
+  // its own hits rather than all of them.
+  std::vector<std::pair<entry, bitmap>> slices;
+  for (auto i = select(ids); !i.done(); i.next()) {
+    auto id = i.get();
+    if (slices.empty() || id > slices.back().first.last) {
+      auto e = find(id);
+      if (e == index_.end())
+        continue;
+      slices.emplace_back(*e, bitmap{});
+    }
+    auto& slice = slices.back().second;
+    slice.append_bits(false, id - slice.size());
+    slice.append_bit(true);
+  }
+  auto extract = [&](std::pair<entry, bitmap> const& slice) -> result_type {
+    auto b = read(slice.first);
+    if (!b)
+      return b.error();
+    return batch::reader{*b}.read(slice.second);
+  };
+  error result;
+  // A task of the pool cannot wait for other tasks of the same pool without
+  // risking a deadlock, so we extract the batches inline instead.
+  if (pool.owns_current_thread()) {
+    for (auto& slice : slices) {
+      auto xs = extract(slice);
+      result = xs ? f(*xs) : xs.error();
+      if (result)
+        break;
+    }
+    return result;
+  }
+  std::deque<std::future<result_type>> inflight;
+  for (auto& slice : slices) {
+    if (inflight.size() >= std::max(window, size_t{1})) {
+      auto xs = inflight.front().get();
+      inflight.pop_front();
+      result = xs ? f(*xs) : xs.error();
+      if (result)
+        break;
+    }
+    auto ptr = &slice;
+    inflight.push_back(pool.submit([=] { return extract(*ptr); }));
+  }
+  // Even after an error, the pending tasks must finish before we return,
+  // because they reference this reader and the slices.
+  while (!inflight.empty()) {
+    auto xs = inflight.front().get();
+    inflight.pop_front();
+    if (!result)
+      result = xs ? f(*xs) : xs.error();
+  }
+  return result;
+}
+
+std::vector<segment::reader::entry>::const_iterator
+segment::reader::find(event_id id) const {
+  // The ID ranges of the batches in a segment do not overlap.
+  auto i = std::upper_bound(index_.begin(), index_.end(), id,
+                            [](event_id x, entry const& e) {
+                              return x < e.first;
+                            });
+  if (i == index_.begin() || (--i)->last < id)
+    return index_.end();
+  return i;
+}
+
+std::vector<segment::reader::entry>
+segment::reader::entries(bitmap const& ids) const {
+  std::vector<entry> result;
+  for (auto i = select(ids); !i.done(); i.next()) {
+    if (!result.empty() && i.get() <= result.back().last)
+      continue; // We already have the batch of this event.
+    auto e = find(i.get());
+    if (e != index_.end())
+      result.push_back(*e);
+  }
+  return result;
+}
+
+expected<batch> segment::reader::read(entry const& e) {
+  auto buf = std::make_shared<std::vector<char>>(e.size);
+  if (e.size > 0 && !file_.read_at(buf->data(), buf->size(), e.offset))
+    return fail<ec::filesystem_error>("failed to read", file_.path());
+  auto ptr = static_cast<char const*>(buf->data());
+  auto end = ptr + buf->size();
+  bitmap ids;
+  char const* bytes;
+  uint64_t size;
+  if (!parse_entry(ptr, end, ids, bytes, size))
+    return fail<ec::parse_error>("malformed segment entry");
+  auto b = batch::view(bytes, size, buf);
+  if (!b)
+    return b.error();
+  if (!b->ids(std::move(ids)))
+    return fail<ec::parse_error>("malformed segment entry");
+  return b;
+}
+
+} // namespace vast
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/error.hpp"
+#include "vast/load.hpp"
+#include "vast/save.hpp"
+#include "vast/segment.hpp"
+#include "vast/segment_store.hpp"
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/detail/assert.hpp"
+#include "vast/detail/byte_swap.hpp"
+
+namespace vast {
+namespace {
+
+using segment_info = segment_store::segment_info;
+
+// A record in the meta data log.
+struct delta {
+  std::vector<uuid> removed;
+  std::vector<segment_info> added;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, delta& x) {
+    return f(x.removed, x.added);
+  }
+};
+
+// Appends a record to the meta data log and syncs it to disk.
+maybe<void> append(path const& filename, delta x) {
+  std::vector<char> buf(sizeof(uint32_t));
+  auto m = save(buf, x);
+  if (!m)
+    return m;
+  auto size = detail::to_network_order(
+    static_cast<uint32_t>(buf.size() - sizeof(uint32_t)));
+  std::memcpy(buf.data(), &size, sizeof(size));
+  file f{filename};
+  m = f.open(file::write_only, true);
+  if (!m)
+    return m;
+  if (!f.write(buf.data(), buf.size()) || !f.sync() || !f.close())
+    return fail<ec::filesystem_error>("failed to append to", filename);
+  return {};
+}
+
+// Replays the meta data log and truncates a record at the end that never
+// completed, because the next append would otherwise follow its remains.
+expected<std::vector<segment_info>> replay(path const& filename) {
+  auto contents = load_contents(filename);
+  if (!contents)
+    return contents.error();
+  std::vector<segment_info> result;
+  auto begin = contents->data();
+  auto ptr = begin;
+  auto end = ptr + contents->size();
+  while (ptr != end) {
+    uint32_t size;
+    if (static_cast<size_t>(end - ptr) < sizeof(size))
+      break;
+    std::memcpy(&size, ptr, sizeof(size));
+    size = detail::to_host_order(size);
+    if (static_cast<size_t>(end - ptr) - sizeof(size) < size)
+      break;
+    delta x;
+    auto data = ptr + sizeof(size);
+    auto m = load(std::vector<char>(data, data + size), x);
+    if (!m)
+      return m.error();
+    ptr = data + size;
+    auto removed = [&](segment_info const& s) {
+      return std::find(x.removed.begin(), x.removed.end(), s.id)
+        != x.removed.end();
+    };
+    result.erase(std::remove_if(result.begin(), result.end(), removed),
+                 result.end());
+    result.insert(result.end(), x.added.begin(), x.added.end());
+  }
+  if (ptr != end) {
+    file f{filename};
+    auto m = f.open(file::write_only, true);
+    if (!m)
+      return m.error();
+    if (!f.truncate(static_cast<uint64_t>(ptr - begin)))
+      return fail<ec::filesystem_error>("failed to truncate", filename);
+  }
+  std::sort(result.begin(), result.end(),
+            [](segment_info const& x, segment_info const& y) {
+              return x.first < y.first;
+            });
+  return result;
+}
+
+// Builds the map from event IDs to segments.
+expected<detail::flat_range_map<event_id, uuid>>
+make_ranges(std::vector<segment_info> const& segments) {
+  detail::flat_range_map<event_id, uuid> result;
+  for (auto& s : segments)
+    if (!result.inject(s.first, s.last + 1, s.id))
+      return fail("overlapping segment", s.id);
+  return result;
+}
+
+} // namespace <anonymous>
+
+segment_store::segment_store(path dir, uint64_t max_segment_size,
+                             size_t max_readers)
+  : dir_{std::move(dir)},
+    max_segment_size_{max_segment_size},
+    readers_{max_readers} {
+  VAST_ASSERT(max_segment_size_ > 0);
+}
+
+maybe<void> segment_store::open() {
+  if (!exists(dir_ / "meta"))
+    return {};
+  auto segments = replay(dir_ / "meta");
+  if (!segments)
+    return segments.error();
+  auto ranges = make_ranges(*segments);
+  if (!ranges)
+    return ranges.error();
+  segments_ = std::move(*segments);
+  ranges_ = std::move(*ranges);
+  return {};
+}
+
+maybe<void> segment_store::put(batch b) {
+  if (b.id_range().first == invalid_event_id)
+    return fail("batch lacks event IDs");
+  // We buffer the batch even after a failed write, so that the caller does
+  // not lose it.
+  auto c = collect(false);
+  if (c && !current_.empty()
+      && current_size_ + b.size() > max_segment_size_)
+    c = flush();
+  current_size_ += b.size();
+  current_.push_back(std::move(b));
+  return c;
+}
+
+maybe<void> segment_store::flush() {
+  // At most one segment is in flight, so we may have to wait here.
+  auto c = collect(true);
+  if (!c || current_.empty())
+    return c;
+  auto batches = std::make_shared<std::vector<batch> const>(
+    std::move(current_));
+  current_.clear();
+  current_size_ = 0;
+  flushing_ = batches;
+  pending_ = io_.submit([=]() -> expected<segment_info> {
+    // The segment file is durable before its record enters the log, so that
+    // the log never references a truncated segment after a crash.
+    auto info = write(*batches);
+    if (!info)
+      return info;
+    auto m = append(dir_ / "meta", delta{{}, {*info}});
+    if (!m) {
+      rm(dir_ / to_string(info->id));
+      return m.error();
+    }
+    return info;
+  });
+  return {};
+}
+
+maybe<void> segment_store::sync() {
+  return collect(true);
+}
+
+expected<std::vector<batch>> segment_store::get(bitmap const& ids) {
+  std::vector<batch> result;
+  std::vector<uuid> candidates;
+  std::vector<batch const*> buffered;
+  auto c = collect(false);
+  if (!c)
+    return c.error();
+  // Lookups consider both the batches being written and the new ones.
+  auto find_buffered = [&](event_id id) -> batch const* {
+    auto contains = [=](batch const& b) {
+      auto range = b.id_range();
+      return range.first <= id && id <= range.second;
+    };
+    if (flushing_) {
+      auto i = std::find_if(flushing_->begin(), flushing_->end(), contains);
+      if (i != flushing_->end())
+        return &*i;
+    }
+    auto i = std::find_if(current_.begin(), current_.end(), contains);
+    return i != current_.end() ? &*i : nullptr;
+  };
+  // Each candidate covers a range of IDs, so we skip all hits in that range.
+  auto next = event_id{0};
+  for (auto i = select(ids); !i.done(); i.next()) {
+    auto id = i.get();
+    if (id < next)
+      continue;
+    auto x = ranges_.find(id);
+    if (std::get<2>(x)) {
+      candidates.push_back(*std::get<2>(x));
+      next = std::get<1>(x);
+    } else if (auto b = find_buffered(id)) {
+      buffered.push_back(b);
+      next = b->id_range().second + 1;
+    }
+  }
+  for (auto& candidate : candidates) {
+    auto reader = readers_.lookup(candidate);
+    if (!reader) {
+      auto r = std::make_unique<segment::reader>(dir_ / to_string(candidate));
+      auto m = r->open();
+      if (!m)
+        return m.error();
+      reader = readers_.insert(candidate, std::move(r)).first;
+    }
+    auto xs = (*reader)->read(ids);
+    if (!xs)
+      return xs.error();
+    std::move(xs->begin(), xs->end(), std::back_inserter(result));
+  }
+  for (auto b : buffered)
+    result.push_back(*b);
+  return result;
+}
+
+expected<size_t> segment_store::compact() {
+  auto c = collect(true);
+  if (!c)
+    return c.error();
+  std::vector<segment_info> segments;
+  std::vector<uuid> obsolete;
+  std::vector<path> written;
+  auto abort = [&](error e) {
+    for (auto& p : written)
+      rm(p);
+    return e;
+  };
+  for (auto i = segments_.begin(); i != segments_.end(); ) {
+    auto j = i + 1;
+    auto bytes = i->bytes;
+    while (j != segments_.end() && bytes + j->bytes <= max_segment_size_)
+      bytes += j++->bytes;
+    if (j - i < 2) {
+      segments.push_back(*i++);
+      continue;
+    }
+    std::vector<batch> batches;
+    for (; i != j; ++i) {
+      auto s = segment::map(dir_ / to_string(i->id));
+      if (!s)
+        return abort(s.error());
+      batches.insert(batches.end(), s->batches().begin(), s->batches().end());
+      obsolete.push_back(i->id);
+    }
+    auto info = write(batches);
+    if (!info)
+      return abort(info.error());
+    written.push_back(dir_ / to_string(info->id));
+    segments.push_back(std::move(*info));
+  }
+  if (obsolete.empty())
+    return size_t{0};
+  auto m = commit(std::move(segments));
+  if (!m)
+    return abort(m.error());
+  for (auto& id : obsolete) {
+    readers_.erase(id);
+    rm(dir_ / to_string(id));
+  }
+  return obsolete.size();
+}
+
+expected<std::vector<segment_store::segment_info>>
+segment_store::expire(timestamp horizon) {
+  auto c = collect(true);
+  if (!c)
+    return c.error();
+  std::vector<segment_info> segments;
+  std::vector<segment_info> expired;
+  for (auto& s : segments_)
+    (s.latest < horizon ? expired : segments).push_back(s);
+  if (expired.empty())
+    return expired;
+  auto m = commit(std::move(segments));
+  if (!m)
+    return m.error();
+  for (auto& s : expired) {
+    readers_.erase(s.id);
+    rm(dir_ / to_string(s.id));
+  }
+  return expired;
+}
+
+std::vector<segment_store::segment_info> const&
+segment_store::segments() const {
+  return segments_;
+}
+
+size_t segment_store::open_segments() const {
+  return readers_.size();
+}
+
+expected<segment_store::segment_info>
+segment_store::write(std::vector<batch> const& batches) {
+  VAST_ASSERT(!batches.empty());
+  if (!exists(dir_)) {
+    auto m = mkdir(dir_);
+    if (!m)
+      return m.error();
+  }
+  segment_info info;
+  info.id = uuid::random();
+  info.first = invalid_event_id;
+  info.last = 0;
+  info.latest = timestamp::min();
+  for (auto& b : batches) {
+    auto range = b.id_range();
+    info.first = std::min(info.first, range.first);
+    info.last = std::max(info.last, range.second);
+    info.latest = std::max(info.latest, b.last());
+  }
+  auto filename = dir_ / to_string(info.id);
+  auto m = segment::write(filename, batches);
+  if (!m)
+    return m.error();
+  file f{filename};
+  size_t size;
+  if (!f.open(file::read_only) || !f.size(size))
+    return fail<ec::filesystem_error>("failed to stat", filename);
+  info.bytes = size;
+  return info;
+}
+
+maybe<void> segment_store::collect(bool wait) {
+  if (!pending_.valid())
+    return {};
+  if (!wait && pending_.wait_for(std::chrono::seconds{0})
+                 != std::future_status::ready)
+    return {};
+  auto info = pending_.get();
+  auto batches = std::move(flushing_);
+  if (!info) {
+    // Keep the batches, so that the next flush tries again.
+    for (auto& b : *batches)
+      current_size_ += b.size();
+    current_.insert(current_.begin(), batches->begin(), batches->end());
+    return info.error();
+  }
+  if (!ranges_.inject(info->first, info->last + 1, info->id))
+    return fail("overlapping segment", info->id);
+  auto i = std::upper_bound(segments_.begin(), segments_.end(), *info,
+                            [](segment_info const& x, segment_info const& y) {
+                              return x.first < y.first;
+                            });
+  segments_.insert(i, std::move(*info));
+  return {};
+}
+
+maybe<void> segment_store::commit(std::vector<segment_info> segments) {
+  std::sort(segments.begin(), segments.end(),
+            [](segment_info const& x, segment_info const& y) {
+              return x.first < y.first;
+            });
+  auto ranges = make_ranges(segments);
+  if (!ranges)
+    return ranges.error();
+  auto tmp = dir_ / "meta.tmp";
+  if (exists(tmp))
+    rm(tmp);
+  // The new log must be durable before the rename makes it visible, because
+  // the callers remove the segment files that the old log references.
+  auto m = append(tmp, delta{{}, segments});
+  if (!m)
+    return m;
+  if (std::rename(tmp.str().c_str(), (dir_ / "meta").str().c_str()) != 0)
+    return fail<ec::filesystem_error>("failed to rename", tmp);
+  segments_ = std::move(segments);
+  ranges_ = std::move(*ranges);
+  return {};
+}
+
+} // namespace vast
@@ -211,6 +211,14 @@ behavior spawn_actor(event_based_actor* self,
           rp.deliver(make_message(error{"not compiled with snappy support"}));
           self->quit(exit::error);
           return;
+#endif
+        } else if (comp == "zstd") {
+#ifdef VAST_HAVE_ZSTD
+          method = io::zstd;
+#else
+          rp.deliver(make_message(error{"not compiled with zstd support"}));
+          self->quit(exit::error);
+          return;
 #endif
         } else {
           rp.deliver(make_message(error{"unknown compression method: ", comp}));
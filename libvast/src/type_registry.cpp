@@ -0,0 +1,61 @@
+#include <limits>
+
+#include <caf/deserializer.hpp>
+#include <caf/serializer.hpp>
+
+#include "vast/type_registry.hpp"
+#include "vast/detail/assert.hpp"
+
+namespace vast {
+
+type_registry::type_registry()
+  : types_{std::make_shared<std::vector<type> const>()} {
+}
+
+type_registry::id_type type_registry::add(type const& t) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto i = ids_.find(t);
+  if (i != ids_.end())
+    return i->second;
+  auto id = static_cast<id_type>(types_->size());
+  VAST_ASSERT(types_->size() < std::numeric_limits<id_type>::max());
+  // Existing snapshots remain valid, so we copy on write. Registrations are
+  // rare compared to lookups.
+  auto types = std::make_shared<std::vector<type>>(*types_);
+  types->push_back(t);
+  types_ = std::move(types);
+  ids_.emplace(t, id);
+  return id;
+}
+
+type const* type_registry::lookup(snapshot_type const& types, id_type id) {
+  if (!types || id >= types->size())
+    return nullptr;
+  return &(*types)[id];
+}
+
+type_registry::snapshot_type type_registry::snapshot() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return types_;
+}
+
+size_t type_registry::size() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return types_->size();
+}
+
+void serialize(caf::serializer& sink, type_registry const& r) {
+  sink << *r.snapshot();
+}
+
+void serialize(caf::deserializer& source, type_registry& r) {
+  std::vector<type> types;
+  source >> types;
+  std::lock_guard<std::mutex> lock{r.mutex_};
+  r.ids_.clear();
+  for (auto i = 0u; i < types.size(); ++i)
+    r.ids_.emplace(types[i], static_cast<type_registry::id_type>(i));
+  r.types_ = std::make_shared<std::vector<type> const>(std::move(types));
+}
+
+} // namespace vast
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cmath>
+#include <functional>
 
 #include "vast/base.hpp"
 #include "vast/concept/parseable/numeric/integral.hpp"
@@ -64,7 +66,7 @@ std::unique_ptr<value_index> value_index::make(type const& t) {
       auto b = parse_base(t);
       if (!b)
         return nullptr;
-      return std::make_unique<arithmetic_index<timestamp>>(std::move(*b));
+      return std::make_unique<timestamp_index>(std::move(*b));
     }
     result_type operator()(string_type const& t) const {
       auto max_length = size_t{1024};
@@ -152,6 +154,49 @@ bool value_index::push_back(data const& x, event_id id) {
   return true;
 }
 
+bool value_index::append(std::vector<data> const& xs,
+                         std::vector<event_id> const& ids) {
+  VAST_ASSERT(xs.size() == ids.size());
+  // Reject out-of-order IDs before touching the index.
+  if (!ids.empty() && ids.front() < offset())
+    return false;
+  if (std::adjacent_find(ids.begin(), ids.end(), std::greater_equal<>{})
+      != ids.end())
+    return false;
+  // First hand the values to the concrete index. Since some indexes consult
+  // the offset while appending, it accounts for the pending values.
+  auto base = mask_.size();
+  auto n = size_t{0};
+  for ( ; n < xs.size(); ++n) {
+    if (!push_back_impl(xs[n], ids[n] - offset()))
+      break;
+    pending_ = ids[n] + 1 - base;
+  }
+  pending_ = 0;
+  // Then append the mask and nil bits of the indexed values run by run.
+  auto next = base;
+  for (auto i = 0u; i < n; ) {
+    auto gap = ids[i] - next;
+    mask_.append_bits(false, gap);
+    none_.append_bits(false, gap);
+    auto j = i + 1;
+    while (j < n && ids[j] == ids[j - 1] + 1)
+      ++j;
+    mask_.append_bits(true, j - i);
+    for (auto k = i; k < j; ) {
+      auto nil = is<none>(xs[k]);
+      auto l = k + 1;
+      while (l < j && is<none>(xs[l]) == nil)
+        ++l;
+      none_.append_bits(nil, l - k);
+      k = l;
+    }
+    next = ids[j - 1] + 1;
+    i = j;
+  }
+  return n == xs.size();
+}
+
 maybe<bitmap> value_index::lookup(relational_operator op, data const& x) const {
   if (is<none>(x)) {
     if (!(op == equal || op == not_equal))
@@ -165,7 +210,103 @@ maybe<bitmap> value_index::lookup(relational_operator op, data const& x) const {
 }
 
 value_index::size_type value_index::offset() const {
-  return mask_.size(); // none_ would work just as well.
+  return mask_.size() + pending_; // none_ would work just as well.
+}
+
+size_t value_index::memusage() const {
+  return mask_.memusage() + none_.memusage() + memusage_impl();
+}
+
+
+timestamp_index::timestamp_index(base b) : bmi_{std::move(b)} {
+}
+
+size_t timestamp_index::checkpoints() const {
+  return bins_.size();
+}
+
+bool timestamp_index::push_back_impl(data const& x, size_type skip) {
+  auto ts = get_if<timestamp>(x);
+  if (!ts)
+    return false;
+  auto value = ts->time_since_epoch().count();
+  auto bin = binner_type::bin(value);
+  auto id = offset() + skip;
+  if (bins_.empty() || bin > bins_.back()) {
+    // A new bin begins at this ID.
+    bins_.push_back(bin);
+    firsts_.push_back(id);
+  } else if (bin < bins_.back()) {
+    // The value arrived out of order and cannot be expressed as part of the
+    // contiguous ID range of its bin.
+    unsorted_.append_bits(false, id - unsorted_.size());
+    unsorted_.append_bit(true);
+    bmi_.push_back(value, id - bmi_.size());
+  }
+  return true;
+}
+
+maybe<bitmap>
+timestamp_index::lookup_impl(relational_operator op, data const& x) const {
+  auto ts = get_if<timestamp>(x);
+  if (!ts)
+    return fail<ec::type_clash>(x);
+  if (!(op == less || op == less_equal || op == equal || op == not_equal
+        || op == greater_equal || op == greater))
+    return fail<ec::unsupported_operator>(op);
+  auto value = ts->time_since_epoch().count();
+  auto bin = binner_type::bin(value);
+  auto off = offset();
+  // Translates a position in the checkpoint array into an ID.
+  auto first_id = [&](auto i) {
+    return i == bins_.end() ? off : firsts_[i - bins_.begin()];
+  };
+  auto lower = first_id(std::lower_bound(bins_.begin(), bins_.end(), bin));
+  auto upper = first_id(std::upper_bound(bins_.begin(), bins_.end(), bin));
+  // Constructs a bitmap with the ID range [l, u) set to 1.
+  auto make_range = [&](event_id l, event_id u) {
+    bitmap result;
+    result.append_bits(false, l);
+    result.append_bits(true, u - l);
+    result.append_bits(false, off - u);
+    return result;
+  };
+  bitmap result;
+  switch (op) {
+    default:
+      break;
+    case less:
+      result = make_range(0, lower);
+      break;
+    case less_equal:
+      result = make_range(0, upper);
+      break;
+    case equal:
+    case not_equal:
+      result = make_range(lower, upper);
+      if (op == not_equal)
+        result.flip();
+      break;
+    case greater_equal:
+      result = make_range(lower, off);
+      break;
+    case greater:
+      result = make_range(upper, off);
+      break;
+  }
+  // In the common case, all values arrived in order and we're done.
+  if (unsorted_.empty())
+    return result;
+  result = result - unsorted_;
+  result |= bmi_.lookup(op, value) & unsorted_;
+  return result;
+}
+
+size_t timestamp_index::memusage_impl() const {
+  return bins_.capacity() * sizeof(value_type)
+         + firsts_.capacity() * sizeof(event_id)
+         + unsorted_.memusage()
+         + bmi_.memusage();
 }
 
 
@@ -264,6 +405,14 @@ string_index::lookup_impl(relational_operator op, data const& x) const {
   }
 }
 
+size_t string_index::memusage_impl() const {
+  auto result = length_.memusage();
+  result += chars_.capacity() * sizeof(char_bitmap_index);
+  for (auto& idx : chars_)
+    result += idx.memusage();
+  return result;
+}
+
 void address_index::init() {
   if (bytes_[0].coder().storage().empty())
     // Initialize on first to make deserialization feasible.
@@ -335,6 +484,13 @@ address_index::lookup_impl(relational_operator op, data const& x) const {
   return fail<ec::type_clash>(x);
 }
 
+size_t address_index::memusage_impl() const {
+  auto result = v4_.memusage();
+  for (auto& idx : bytes_)
+    result += idx.memusage();
+  return result;
+}
+
 void subnet_index::init() {
   if (length_.coder().storage().empty())
     length_ = prefix_index{128 + 1}; // Valid prefixes range from /0 to /128.
@@ -367,6 +523,10 @@ subnet_index::lookup_impl(relational_operator op, data const& x) const {
   return result;
 }
 
+size_t subnet_index::memusage_impl() const {
+  return network_.memusage() + length_.memusage();
+}
+
 
 void port_index::init() {
   if (num_.coder().storage().empty()) {
@@ -402,6 +562,10 @@ port_index::lookup_impl(relational_operator op, data const& x) const {
   return n;
 }
 
+size_t port_index::memusage_impl() const {
+  return num_.memusage() + proto_.memusage();
+}
+
 
 sequence_index::sequence_index(vast::type t, size_t max_size)
   : max_size_{max_size},
@@ -452,6 +616,14 @@ sequence_index::lookup_impl(relational_operator op, data const& x) const {
   return result;
 }
 
+size_t sequence_index::memusage_impl() const {
+  auto result = size_.memusage();
+  result += elements_.capacity() * sizeof(std::unique_ptr<value_index>);
+  for (auto& idx : elements_)
+    result += idx->memusage();
+  return result;
+}
+
 void serialize(caf::serializer& sink, sequence_index const& idx) {
   sink & static_cast<value_index const&>(idx);
   sink & idx.value_type_;
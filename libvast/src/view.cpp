@@ -0,0 +1,124 @@
+#include "vast/data.hpp"
+#include "vast/view.hpp"
+
+namespace vast {
+
+namespace {
+
+struct view_maker {
+  template <class T>
+  data_view operator()(T const& x) const {
+    return x;
+  }
+
+  data_view operator()(std::string const& x) const {
+    return string_view{x};
+  }
+
+  data_view operator()(pattern const&) const {
+    return &self;
+  }
+
+  data_view operator()(enumeration const&) const {
+    return &self;
+  }
+
+  data_view operator()(vector const&) const {
+    return &self;
+  }
+
+  data_view operator()(set const&) const {
+    return &self;
+  }
+
+  data_view operator()(table const&) const {
+    return &self;
+  }
+
+  data const& self;
+};
+
+struct materializer {
+  template <class T>
+  data operator()(T const& x) const {
+    return x;
+  }
+
+  data operator()(none) const {
+    return nil;
+  }
+
+  data operator()(string_view x) const {
+    return to_string(x);
+  }
+
+  data operator()(data const* x) const {
+    return *x;
+  }
+};
+
+// Evaluates string predicates without copying the string.
+bool evaluate_string(string_view lhs, relational_operator op,
+                     std::string const& rhs, bool& result) {
+  auto x = string_view{rhs};
+  switch (op) {
+    default:
+      return false;
+    case in:
+      result = x.contains(lhs);
+      break;
+    case not_in:
+      result = !x.contains(lhs);
+      break;
+    case ni:
+      result = lhs.contains(x);
+      break;
+    case not_ni:
+      result = !lhs.contains(x);
+      break;
+    case equal:
+      result = lhs == x;
+      break;
+    case not_equal:
+      result = lhs != x;
+      break;
+    case less:
+      result = lhs < x;
+      break;
+    case less_equal:
+      result = lhs <= x;
+      break;
+    case greater:
+      result = lhs > x;
+      break;
+    case greater_equal:
+      result = lhs >= x;
+      break;
+  }
+  return true;
+}
+
+} // namespace <anonymous>
+
+data_view make_view(data const& x) {
+  return visit(view_maker{x}, x);
+}
+
+data materialize(data_view const& x) {
+  return visit(materializer{}, x);
+}
+
+bool evaluate(data_view const& lhs, relational_operator op, data const& rhs) {
+  if (auto x = get_if<data const*>(lhs))
+    return evaluate(**x, op, rhs);
+  if (auto x = get_if<string_view>(lhs)) {
+    auto str = get_if<std::string>(rhs);
+    auto result = false;
+    if (str && evaluate_string(*x, op, *str, result))
+      return result;
+  }
+  // Materializing basic values does not allocate.
+  return evaluate(materialize(lhs), op, rhs);
+}
+
+} // namespace vast
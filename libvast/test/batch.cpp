@@ -1,13 +1,19 @@
 #include "vast/batch.hpp"
 #include "vast/event.hpp"
+#include "vast/expression.hpp"
 #include "vast/load.hpp"
 #include "vast/save.hpp"
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/address.hpp"
+#include "vast/concept/parseable/vast/expression.hpp"
+#include "vast/concept/parseable/vast/time.hpp"
 #include "vast/concept/printable/vast/event.hpp"
 
 #define SUITE batch
 #include "test.hpp"
 
 using namespace vast;
+using namespace std::string_literals;
 
 namespace {
 
@@ -60,6 +66,109 @@ TEST(events with IDs) {
   CHECK_EQUAL(xs->back().id(), 666u + 990);
 }
 
+TEST(reads into existing buffer) {
+  batch::writer writer{compression::lz4, 64};
+  for (auto& e : events)
+    REQUIRE(writer.write(e));
+  auto b = writer.seal();
+  b.ids(666, 666 + 1000);
+  batch::reader reader{b};
+  bitmap ids;
+  ids.append_bits(false, 666 + 100);
+  ids.append_bits(true, 200);
+  std::vector<event> xs;
+  REQUIRE(!reader.read(ids, xs));
+  REQUIRE_EQUAL(xs.size(), 200u);
+  MESSAGE("subsequent reads append");
+  REQUIRE(!reader.read(ids, xs));
+  REQUIRE_EQUAL(xs.size(), 400u);
+  CHECK(xs[0] == events[100]);
+  CHECK(xs[200] == events[100]);
+  CHECK(xs.back() == events[299]);
+}
+
+TEST(block-wise reads) {
+  batch::writer writer{compression::lz4, 64};
+  for (auto& e : events)
+    REQUIRE(writer.write(e));
+  auto b = writer.seal();
+  b.ids(666, 666 + 1000);
+  batch::reader reader{b};
+  auto xs = reader.read();
+  REQUIRE(xs);
+  CHECK(*xs == events);
+  MESSAGE("read events from the first, a middle, and the last block");
+  bitmap ids;
+  ids.append_bits(false, 666 + 3);
+  ids.append_bit(true);
+  ids.append_bits(false, 500);
+  ids.append_bits(true, 100);
+  ids.append_bits(false, 395);
+  ids.append_bit(true);
+  xs = reader.read(ids);
+  REQUIRE(xs);
+  REQUIRE_EQUAL(xs->size(), 102u);
+  CHECK_EQUAL(xs->front(), events[3]);
+  CHECK_EQUAL((*xs)[1], events[504]);
+  CHECK_EQUAL((*xs)[100], events[603]);
+  CHECK_EQUAL(xs->back(), events[999]);
+}
+
+#ifdef VAST_HAVE_ZSTD
+TEST(compression dictionaries) {
+  MESSAGE("train dictionaries from existing batches");
+  std::vector<batch> batches;
+  for (auto i = 0; i < 10; ++i) {
+    batch::writer writer{compression::zstd, 16};
+    for (auto& e : events)
+      REQUIRE(writer.write(e));
+    batches.push_back(writer.seal());
+  }
+  auto dicts = train_dictionaries(batches, 4 << 10);
+  REQUIRE(dicts);
+  REQUIRE_EQUAL(dicts->count(event_type), 1u);
+  MESSAGE("write a batch with dictionaries");
+  batch::writer writer{compression::zstd, 16, &*dicts};
+  for (auto& e : events)
+    REQUIRE(writer.write(e));
+  auto b = writer.seal();
+  b.ids(666, 666 + 1000);
+  CHECK(!batch::reader{b}.read());
+  batch::reader reader{b, &*dicts};
+  auto xs = reader.read();
+  REQUIRE(xs);
+  CHECK(*xs == events);
+  MESSAGE("other methods ignore dictionaries");
+  batch::writer lz4{compression::lz4, 16, &*dicts};
+  for (auto& e : events)
+    REQUIRE(lz4.write(e));
+  b = lz4.seal();
+  b.ids(666, 666 + 1000);
+  CHECK(batch::reader{b}.read());
+}
+#endif // VAST_HAVE_ZSTD
+
+TEST(type registry) {
+  type_registry registry;
+  batch::writer plain{compression::null, 16};
+  batch::writer writer{compression::null, 16, nullptr, &registry};
+  for (auto& e : events) {
+    REQUIRE(plain.write(e));
+    REQUIRE(writer.write(e));
+  }
+  auto b = writer.seal();
+  b.ids(666, 666 + 1000);
+  MESSAGE("type IDs take less space than full types");
+  CHECK_LESS(b.size(), plain.seal().size());
+  CHECK_EQUAL(registry.size(), 1u);
+  MESSAGE("reading requires the registered types");
+  CHECK(!batch::reader{b}.read());
+  batch::reader reader{b, nullptr, registry.snapshot()};
+  auto xs = reader.read();
+  REQUIRE(xs);
+  CHECK(*xs == events);
+}
+
 TEST(events without IDs) {
   batch::writer writer{compression::null};
   std::cout << event_type.name() << std::endl;
@@ -79,3 +188,159 @@ TEST(events without IDs) {
 }
 
 FIXTURE_SCOPE_END()
+
+TEST(header) {
+  auto first = *to<timestamp>("2014-01-16+05:30:12");
+  batch::writer writer{compression::lz4};
+  for (auto i = 0; i < 100; ++i) {
+    auto e = event::make(integer{i}, integer_type{});
+    e.timestamp(first + std::chrono::seconds{i});
+    REQUIRE(writer.write(e));
+  }
+  auto b = writer.seal();
+  CHECK_EQUAL(b.id_range().first, invalid_event_id);
+  REQUIRE(b.ids(42, 142));
+  MESSAGE("read the header without decompressing events");
+  CHECK_EQUAL(b.events(), 100u);
+  CHECK(b.first() == first);
+  CHECK(b.last() == first + std::chrono::seconds{99});
+  CHECK_EQUAL(b.id_range().first, 42u);
+  CHECK_EQUAL(b.id_range().second, 141u);
+  MESSAGE("the header survives serialization");
+  std::vector<char> buf;
+  save(buf, b);
+  batch c;
+  load(buf, c);
+  CHECK_EQUAL(c.events(), 100u);
+  CHECK(c.first() == b.first());
+  CHECK(c.last() == b.last());
+  CHECK_EQUAL(c.id_range().second, 141u);
+  MESSAGE("check time restrictions");
+  auto match = [&](std::string const& str) {
+    auto expr = to<expression>(str);
+    REQUIRE(expr);
+    return may_match(b, *expr);
+  };
+  CHECK(match("&time > 2014-01-16+05:31:00"));
+  CHECK(match("&time == 2014-01-16+05:30:42"));
+  CHECK(match("&time < 2014-01-16+05:30:13 || &time > 2015-01-01+00:00:00"));
+  CHECK(!match("&time < 2014-01-16+05:30:12"));
+  CHECK(!match("&time > 2014-01-16+05:31:51"));
+  CHECK(!match("&time > 2014-01-16+05:30:20 && &time < 2014-01-16+05:30:00"));
+  CHECK(match("&type == \"foo\""));
+}
+
+TEST(columnar records) {
+  auto conn = record_type{
+    {"ts", timestamp_type{}},
+    {"id", record_type{
+      {"orig_h", address_type{}},
+      {"orig_p", port_type{}}
+    }},
+    {"method", string_type{}},
+    {"bytes", count_type{}}
+  };
+  conn.name() = "conn";
+  auto t = type{conn};
+  auto orig = *to<address>("10.0.0.1");
+  auto epoch = timestamp{} + std::chrono::hours{24 * 365 * 45};
+  std::vector<event> xs;
+  for (auto i = 0; i < 1000; ++i) {
+    auto ts = epoch + std::chrono::milliseconds{i};
+    auto method = i % 3 == 0 ? data{} : data{i % 2 == 0 ? "GET"s : "POST"s};
+    auto x = vector{ts, vector{orig, port(1024 + i, port::tcp)}, method,
+                    count(i * 10)};
+    xs.push_back(event{{std::move(x), t}});
+    xs.back().timestamp(ts);
+    // Interleave events of other types and records with missing structure.
+    if (i % 100 == 0) {
+      xs.push_back(event::make(integer{i}, integer_type{}));
+      xs.push_back(event{{vector{ts, nil, "PUT"s, count(1)}, t}});
+    }
+  }
+  MESSAGE("write a batch");
+  batch::writer writer{compression::lz4};
+  for (auto& x : xs)
+    REQUIRE(writer.write(x));
+  auto b = writer.seal();
+  REQUIRE(b.ids(0, xs.size()));
+  for (auto i = 0u; i < xs.size(); ++i)
+    xs[i].id(i);
+  MESSAGE("read a batch");
+  batch::reader reader{b};
+  auto ys = reader.read();
+  REQUIRE(ys);
+  CHECK(*ys == xs);
+  MESSAGE("read selected events");
+  bitmap ids;
+  ids.append_bits(false, 5);
+  ids.append_bits(true, 2);
+  ids.append_bits(false, 500);
+  ids.append_bit(true);
+  ys = reader.read(ids);
+  REQUIRE(ys);
+  REQUIRE_EQUAL(ys->size(), 3u);
+  CHECK_EQUAL(ys->front(), xs[5]);
+  CHECK_EQUAL(ys->back(), xs[507]);
+  MESSAGE("project selected fields");
+  auto fields = std::vector<offset>{{1, 0}, {0}, {1}};
+  auto projected = record_type{
+    {"id.orig_h", address_type{}},
+    {"ts", timestamp_type{}},
+    {"id", record_type{
+      {"orig_h", address_type{}},
+      {"orig_p", port_type{}}
+    }}
+  };
+  projected.name() = "conn";
+  ids = bitmap{};
+  ids.append_bit(false);
+  ids.append_bits(true, 2); // an integer and a non-columnar record
+  ids.append_bits(false, 2);
+  ids.append_bit(true);
+  ys = reader.read(ids, fields);
+  REQUIRE(ys);
+  REQUIRE_EQUAL(ys->size(), 2u);
+  CHECK_EQUAL(ys->front().type(), type{projected});
+  CHECK_EQUAL(ys->front().id(), 2u);
+  CHECK_EQUAL(ys->front().data(), data(vector{nil, epoch, nil}));
+  auto ts = epoch + std::chrono::milliseconds{3};
+  auto id = vector{orig, port(1024 + 3, port::tcp)};
+  CHECK_EQUAL(ys->back().type(), type{projected});
+  CHECK_EQUAL(ys->back().data(), data(vector{orig, ts, id}));
+  CHECK(ys->back().timestamp() == ts);
+  MESSAGE("evaluate predicates without materializing events");
+  auto check_evaluate = [&](offset const& o, relational_operator op,
+                            data const& rhs) {
+    std::vector<event_id> expected;
+    for (auto& x : xs)
+      if (auto y = get(x.data(), o))
+        if (evaluate(*y, op, rhs))
+          expected.push_back(x.id());
+    auto hits = reader.evaluate(o, op, rhs);
+    REQUIRE(hits);
+    std::vector<event_id> actual;
+    for (auto i = select(*hits); !i.done(); i.next())
+      actual.push_back(i.get());
+    CHECK(!expected.empty());
+    CHECK(actual == expected);
+  };
+  check_evaluate({2}, equal, "GET"s);
+  check_evaluate({1, 1}, greater, port(1500, port::tcp));
+  check_evaluate({1}, equal, vector{orig, port(1024 + 7, port::tcp)});
+  check_evaluate({3}, less, count{50});
+  MESSAGE("visit events as views");
+  ids = bitmap{};
+  ids.append_bits(true, xs.size());
+  std::vector<event> zs;
+  auto strings = 0u;
+  auto visit_view = [&](batch::reader::event_view const& v) {
+    zs.push_back(v.materialize());
+    // Strings of columnar records reference the decoded column in place.
+    if (v.event_type() == t && v.size() == 5 && is<string_view>(v[3]))
+      ++strings;
+  };
+  REQUIRE(!reader.each(ids, visit_view));
+  CHECK(zs == xs);
+  CHECK_EQUAL(strings, 666u);
+}
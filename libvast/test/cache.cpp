@@ -62,3 +62,63 @@ TEST(MRU cache) {
   CHECK(!c.contains("foo"));
   CHECK(c.contains("fu"));
 }
+
+TEST(SLRU cache) {
+  cache<int, int, slru> c{10};
+  for (auto i = 0; i < 10; ++i)
+    CHECK(c.insert(i, i).second);
+  for (auto i = 0; i < 8; ++i)
+    CHECK(c.lookup(i));
+  MESSAGE("a scan does not displace frequently accessed entries");
+  for (auto i = 100; i < 200; ++i)
+    c.insert(i, i);
+  CHECK_EQUAL(c.size(), 10u);
+  for (auto i = 0; i < 8; ++i)
+    CHECK(c.contains(i));
+  CHECK(!c.contains(8));
+  CHECK(c.contains(199));
+  MESSAGE("erasure");
+  CHECK_EQUAL(c.erase(3), 1u);
+  CHECK_EQUAL(c.erase(3), 0u);
+  CHECK(c.insert(3, 3).second);
+  c.clear();
+  CHECK(c.empty());
+  CHECK(c.insert(42, 42).second);
+}
+
+TEST(weighted cache) {
+  auto weight = [](std::string const& x) { return x.size(); };
+  cache<int, std::string, lru, decltype(weight)> c{10, weight};
+  CHECK(c.insert(1, "foo").second);
+  CHECK(c.insert(2, "quux").second);
+  CHECK_EQUAL(c.weight(), 7u);
+  CHECK(c.insert(3, "bar").second);
+  CHECK_EQUAL(c.size(), 3u);
+  MESSAGE("evict until the new entry fits");
+  CHECK(c.insert(4, "corge").second);
+  CHECK(!c.contains(1));
+  CHECK(!c.contains(2));
+  CHECK_EQUAL(c.weight(), 8u);
+  MESSAGE("shrinking the capacity");
+  c.capacity(5);
+  CHECK_EQUAL(c.size(), 1u);
+  CHECK(c.contains(4));
+  CHECK(c.erase(4) == 1);
+  CHECK_EQUAL(c.weight(), 0u);
+}
+
+TEST(sharded cache) {
+  sharded_cache<int, int> c{64, 4};
+  for (auto i = 0; i < 32; ++i)
+    CHECK(c.insert(i, i * i));
+  CHECK(!c.insert(3, 42));
+  auto x = c.lookup(3);
+  REQUIRE(x);
+  CHECK_EQUAL(*x, 9);
+  CHECK(!c.lookup(100));
+  CHECK_EQUAL(c.erase(3), 1u);
+  CHECK(!c.lookup(3));
+  CHECK_LESS_EQUAL(c.size(), 31u);
+  c.clear();
+  CHECK_EQUAL(c.weight(), 0u);
+}
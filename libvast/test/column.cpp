@@ -0,0 +1,160 @@
+#include "vast/data.hpp"
+#include "vast/detail/column.hpp"
+#include "vast/view.hpp"
+
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/address.hpp"
+#include "vast/concept/parseable/vast/subnet.hpp"
+#include "vast/concept/printable/vast/data.hpp"
+
+#define SUITE column
+#include "test.hpp"
+
+using namespace vast;
+using namespace vast::detail;
+using namespace std::string_literals;
+
+namespace {
+
+// Encodes and decodes a column.
+vector roundtrip(vector const& xs, size_t* bytes = nullptr) {
+  std::vector<char> buf;
+  encode_column(xs, buf);
+  if (bytes)
+    *bytes = buf.size();
+  auto ys = decode_column(buf.data(), buf.data() + buf.size());
+  REQUIRE(ys);
+  return std::move(*ys);
+}
+
+} // namespace <anonymous>
+
+TEST(empty and nil) {
+  CHECK_EQUAL(roundtrip({}), vector{});
+  auto xs = vector{nil, nil, nil};
+  CHECK_EQUAL(roundtrip(xs), xs);
+}
+
+TEST(booleans) {
+  auto xs = vector{true, false, nil, true, true, false, false, true, true};
+  CHECK_EQUAL(roundtrip(xs), xs);
+}
+
+TEST(integral values) {
+  auto xs = vector{integer{-3}, integer{42}, nil, integer{-1000}, integer{0}};
+  CHECK_EQUAL(roundtrip(xs), xs);
+  xs = vector{count{0}, count{1}, count{2}, std::numeric_limits<count>::max()};
+  CHECK_EQUAL(roundtrip(xs), xs);
+  MESSAGE("deltas of sorted values take a single byte");
+  xs.clear();
+  for (auto i = 0; i < 1000; ++i)
+    xs.push_back(timestamp{interval{1400000000000000000 + i}});
+  size_t bytes;
+  CHECK_EQUAL(roundtrip(xs, &bytes), xs);
+  CHECK_LESS(bytes, 1000u + 16);
+  xs = vector{interval{-5}, interval{10}, interval{7}};
+  CHECK_EQUAL(roundtrip(xs), xs);
+}
+
+TEST(strings) {
+  MESSAGE("dictionary");
+  auto xs = vector{"GET"s, "POST"s, "GET"s, nil, "GET"s, "GET"s, "POST"s};
+  CHECK_EQUAL(roundtrip(xs), xs);
+  MESSAGE("plain");
+  xs = vector{"foo"s, "bar"s, ""s, "baz"s};
+  CHECK_EQUAL(roundtrip(xs), xs);
+}
+
+TEST(network types) {
+  auto xs = vector{*to<address>("10.0.0.1"), *to<address>("ff01::1"), nil};
+  CHECK_EQUAL(roundtrip(xs), xs);
+  xs = vector{*to<subnet>("10.0.0.0/8"), *to<subnet>("2001:db8::/32")};
+  CHECK_EQUAL(roundtrip(xs), xs);
+  xs = vector{port{53, port::udp}, port{443, port::tcp}, nil, port{0}};
+  CHECK_EQUAL(roundtrip(xs), xs);
+}
+
+TEST(generic) {
+  auto xs = vector{real{4.2}, real{-0.5}};
+  CHECK_EQUAL(roundtrip(xs), xs);
+  xs = vector{integer{42}, "foo"s, nil, vector{count{1}, true}, set{real{1}}};
+  CHECK_EQUAL(roundtrip(xs), xs);
+}
+
+TEST(homogeneous containers and patterns) {
+  auto columns = std::vector<vector>{
+    {vector{count{1}, "foo"s}, nil, vector{}, vector{real{4.2}}},
+    {set{integer{1}, integer{2}}, set{}, nil},
+    {pattern{"fo+"}, nil, pattern{"ba[rz]"}},
+  };
+  for (auto& xs : columns) {
+    CHECK_EQUAL(roundtrip(xs), xs);
+    std::vector<char> buf;
+    encode_column(xs, buf);
+    auto view = column_view::make(buf.data(), buf.data() + buf.size());
+    REQUIRE(view);
+    REQUIRE_EQUAL(view->size(), xs.size());
+    for (auto i = 0u; i < xs.size(); ++i)
+      CHECK_EQUAL(materialize((*view)[i]), xs[i]);
+  }
+}
+
+TEST(decoding into existing vector) {
+  std::vector<char> buf;
+  auto xs = vector{"foo"s, nil, "bar"s, nil, nil, "baz"s};
+  encode_column(xs, buf);
+  vector ys{integer{1}, integer{2}};
+  CHECK(!decode_column(buf.data(), buf.data() + buf.size(), ys));
+  CHECK_EQUAL(ys, xs);
+}
+
+TEST(column view) {
+  std::vector<char> buf;
+  auto xs = vector{"GET"s, nil, "POST"s, "GET"s, "GET"s, nil, "GET"s};
+  encode_column(xs, buf);
+  auto view = column_view::make(buf.data(), buf.data() + buf.size());
+  REQUIRE(view);
+  REQUIRE_EQUAL(view->size(), xs.size());
+  for (auto i = 0u; i < xs.size(); ++i)
+    CHECK_EQUAL(materialize((*view)[i]), xs[i]);
+  auto str = get_if<string_view>((*view)[2]);
+  REQUIRE(str);
+  MESSAGE("strings reference the encoded bytes");
+  CHECK(str->data() >= buf.data() && str->data() < buf.data() + buf.size());
+  MESSAGE("mixed values");
+  buf.clear();
+  xs = vector{integer{42}, "foo"s, nil, vector{count{1}, true}};
+  encode_column(xs, buf);
+  view = column_view::make(buf.data(), buf.data() + buf.size());
+  REQUIRE(view);
+  REQUIRE_EQUAL(view->size(), xs.size());
+  for (auto i = 0u; i < xs.size(); ++i)
+    CHECK_EQUAL(materialize((*view)[i]), xs[i]);
+}
+
+TEST(malformed input) {
+  std::vector<char> buf;
+  encode_column(vector{"foo"s, "bar"s, "baz"s}, buf);
+  buf.resize(buf.size() - 2);
+  CHECK(!decode_column(buf.data(), buf.data() + buf.size()));
+}
+
+TEST(untrusted column size) {
+  std::vector<char> buf;
+  encode_column(vector{"foo"s, "bar"s, "baz"s}, buf);
+  auto begin = buf.data();
+  auto end = buf.data() + buf.size();
+  MESSAGE("the number of values must not exceed the given maximum");
+  CHECK(decode_column(begin, end, 3));
+  CHECK(!decode_column(begin, end, 2));
+  CHECK(!column_view::make(begin, end, 2));
+  MESSAGE("a huge number of values must not exceed the input");
+  REQUIRE_EQUAL(buf.front(), 3);
+  char huge[] = {'\x80', '\x80', '\x80', '\x80', '\x80', '\x20'}; // 2^40
+  buf.erase(buf.begin());
+  buf.insert(buf.begin(), huge, huge + sizeof(huge));
+  begin = buf.data();
+  end = buf.data() + buf.size();
+  CHECK(!decode_column(begin, end));
+  CHECK(!column_view::make(begin, end));
+}
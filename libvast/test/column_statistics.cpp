@@ -0,0 +1,45 @@
+#include "vast/column_statistics.hpp"
+#include "vast/load.hpp"
+#include "vast/save.hpp"
+
+#define SUITE expression
+#include "test.hpp"
+
+using namespace vast;
+using namespace std::string_literals;
+
+TEST(column statistics) {
+  column_statistics stats;
+  CHECK_EQUAL(stats.selectivity(equal, data{integer{42}}), 0.0);
+  for (auto i = 0; i < 10000; ++i)
+    stats.add(i % 10 == 0 ? data{nil} : data{integer{i % 50}});
+  CHECK_EQUAL(stats.count(), 10000u);
+  MESSAGE("distinct values");
+  CHECK_EQUAL(stats.distinct(), 45u);
+  MESSAGE("selectivity");
+  CHECK_EQUAL(stats.selectivity(equal, nil), 0.1);
+  auto x = stats.selectivity(less, data{integer{25}});
+  CHECK_GREATER(x, 0.3);
+  CHECK_LESS(x, 0.6);
+  x = stats.selectivity(equal, data{integer{1000}});
+  CHECK_GREATER(x, 0.0);
+  CHECK_LESS(x, 0.01);
+  CHECK_EQUAL(stats.selectivity(greater_equal, data{integer{0}}), 0.9);
+  MESSAGE("serialization");
+  std::vector<char> buf;
+  save(buf, stats);
+  column_statistics copy;
+  load(buf, copy);
+  CHECK_EQUAL(copy.count(), stats.count());
+  CHECK_EQUAL(copy.selectivity(less, data{integer{25}}),
+              stats.selectivity(less, data{integer{25}}));
+}
+
+TEST(distinct value estimate) {
+  column_statistics stats;
+  for (auto i = 0; i < 100000; ++i)
+    stats.add("foo"s + std::to_string(i % 20000));
+  auto n = stats.distinct();
+  CHECK_GREATER(n, 10000u);
+  CHECK_LESS(n, 40000u);
+}
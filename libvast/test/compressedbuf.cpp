@@ -1,4 +1,5 @@
 #include "vast/detail/compressedbuf.hpp"
+#include "vast/detail/thread_pool.hpp"
 #include "vast/concept/printable/stream.hpp"
 #include "vast/concept/printable/vast/compression.hpp"
 
@@ -46,6 +47,9 @@ TEST(compressedbuf - iostream interface) {
   std::vector<compression> methods = {compression::null, compression::lz4};
 #ifdef VAST_HAVE_SNAPPY
   methods.push_back(compression::snappy);
+#endif
+#ifdef VAST_HAVE_ZSTD
+  methods.push_back(compression::zstd);
 #endif
   std::vector<size_t> block_sizes = {1, 2, 64, 256, 1024, 16 << 10};
   auto data = "Im Kampf zwischen dir und der Welt sekundiere der Welt."s;
@@ -94,3 +98,33 @@ TEST(compressedbuf - xsgetn) {
   CHECK_EQUAL(n, static_cast<std::streamsize>(data.size()));
   CHECK_EQUAL(str, data);
 }
+
+TEST(compressedbuf - thread pool) {
+  thread_pool pool{4};
+  auto data = "Wer mit Ungeheuern kaempft, mag zusehn."s;
+  auto inflation = 1000;
+  std::string expected;
+  for (auto i = 0; i < inflation; ++i)
+    expected += data;
+  MESSAGE("compress blocks concurrently");
+  std::stringbuf buf;
+  compressedbuf sink{buf, compression::lz4, 64, 0, &pool};
+  std::ostream os{&sink};
+  for (auto i = 0; i < inflation; ++i)
+    os << data;
+  os.flush();
+  MESSAGE("the format is the same as with sequential compression");
+  std::stringbuf sequential;
+  compressedbuf sequential_sink{sequential, compression::lz4, 64};
+  std::ostream sequential_os{&sequential_sink};
+  for (auto i = 0; i < inflation; ++i)
+    sequential_os << data;
+  sequential_os.flush();
+  CHECK(buf.str() == sequential.str());
+  MESSAGE("uncompress blocks with read-ahead");
+  compressedbuf source{buf, compression::lz4, 64, 0, &pool};
+  std::istream is{&source};
+  std::stringstream ss;
+  ss << is.rdbuf();
+  CHECK(ss.str() == expected);
+}
@@ -40,6 +40,37 @@ TEST(tables) {
   CHECK(i->second == 993u);
   CHECK(ports.emplace("telnet", 23u).second);
   CHECK(!ports.emplace("http", 8080u).second);
+  MESSAGE("entries are sorted by key");
+  CHECK(ports.begin()->first == "http");
+  CHECK(ports.rbegin()->first == "telnet");
+  ports["ssh"] = 2222u;
+  CHECK(ports.at("ssh") == 2222u);
+  CHECK_EQUAL(ports.erase("ssh"), 1u);
+  CHECK_EQUAL(ports.size(), 4u);
+  MESSAGE("bulk insertion keeps existing entries");
+  std::vector<std::pair<data, data>> xs{{"smtp", 25u}, {"http", 8080u},
+                                        {"dns", 53u}, {"smtp", 587u}};
+  ports.insert(xs.begin(), xs.end());
+  CHECK_EQUAL(ports.size(), 6u);
+  CHECK(ports.at("http") == 80u);
+  CHECK(ports.at("smtp") == 25u);
+  CHECK(ports.begin()->first == "dns");
+}
+
+TEST(compact representation) {
+  MESSAGE("sets and tables are no larger than strings");
+  CHECK(sizeof(set) <= sizeof(std::string));
+  CHECK(sizeof(table) <= sizeof(std::string));
+  CHECK(sizeof(data) <= sizeof(std::string) + sizeof(size_t));
+  auto s = set{3, 1, 2, 1};
+  REQUIRE_EQUAL(s.size(), 3u);
+  CHECK(*s.begin() == 1);
+  CHECK(*s.rbegin() == 3);
+  CHECK(s.contains(2));
+  auto xs = std::vector<data>{5, 2, 4};
+  CHECK(!s.insert(xs.begin(), xs.end()));
+  REQUIRE_EQUAL(s.size(), 5u);
+  CHECK(*s.rbegin() == 5);
 }
 
 TEST(records) {
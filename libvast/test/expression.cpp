@@ -1,5 +1,8 @@
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/column_statistics.hpp"
 #include "vast/event.hpp"
 #include "vast/expression.hpp"
+#include "vast/expression_visitors.hpp"
 #include "vast/load.hpp"
 #include "vast/logger.hpp"
 #include "vast/save.hpp"
@@ -9,6 +12,7 @@
 #include "vast/concept/parseable/vast/schema.hpp"
 #include "vast/concept/parseable/vast/time.hpp"
 #include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/bitmap.hpp"
 #include "vast/concept/printable/vast/expression.hpp"
 
 #define SUITE expression
@@ -114,3 +118,85 @@ TEST(normalization) {
 }
 
 FIXTURE_SCOPE_END()
+
+TEST(query planning) {
+  column_statistics a;
+  column_statistics b;
+  for (auto i = 0; i < 1000; ++i) {
+    a.add(integer{i});
+    b.add(count(i % 2));
+  }
+  auto statistics = [&](predicate const& p) -> column_statistics const* {
+    auto e = get_if<key_extractor>(p.lhs);
+    if (e && e->key == key{"a"})
+      return &a;
+    if (e && e->key == key{"b"})
+      return &b;
+    return nullptr;
+  };
+  auto pa = predicate{key_extractor{{"a"}}, less, data{integer{10}}};
+  auto pb = predicate{key_extractor{{"b"}}, equal, data{count{1}}};
+  auto pc = predicate{key_extractor{{"c"}}, equal, data{count{0}}};
+  MESSAGE("estimation");
+  selectivity_estimator estimator{statistics};
+  CHECK_LESS(estimator(pa), 0.1);
+  CHECK_GREATER(estimator(pb), 0.3);
+  CHECK_EQUAL(estimator(pc), 1.0);
+  MESSAGE("conjunctions start with the most selective operand");
+  auto planned = visit(query_planner{statistics}, conjunction{pc, pb, pa});
+  auto c = get_if<conjunction>(planned);
+  REQUIRE(c);
+  REQUIRE_EQUAL(c->size(), 3u);
+  CHECK((*c)[0] == pa);
+  CHECK((*c)[1] == pb);
+  CHECK((*c)[2] == pc);
+  MESSAGE("disjunctions start with the least selective operand");
+  planned = visit(query_planner{statistics}, disjunction{pa, pb});
+  auto d = get_if<disjunction>(planned);
+  REQUIRE(d);
+  CHECK((*d)[0] == pb);
+}
+
+TEST(bitmap evaluation) {
+  auto pa = predicate{key_extractor{{"a"}}, equal, data{integer{1}}};
+  auto pb = predicate{key_extractor{{"b"}}, equal, data{integer{2}}};
+  auto pc = predicate{key_extractor{{"c"}}, equal, data{integer{3}}};
+  auto make = [](std::string const& bits) {
+    bitmap result;
+    for (auto c : bits)
+      result.append_bit(c == '1');
+    return result;
+  };
+  std::vector<predicate> lookups;
+  std::vector<bitmap> restrictions;
+  auto lookup = [&](predicate const& p, bitmap const* restriction)
+    -> expected<bitmap> {
+    lookups.push_back(p);
+    restrictions.push_back(restriction ? *restriction : bitmap{});
+    if (p == pa)
+      return make("0110");
+    if (p == pb)
+      return make("1100");
+    return make("0000");
+  };
+  MESSAGE("conjunctions pass on intermediate hits");
+  auto hits = visit(bitmap_evaluator{lookup}, conjunction{pa, pb});
+  REQUIRE(hits);
+  CHECK_EQUAL(*hits, make("0100"));
+  REQUIRE_EQUAL(restrictions.size(), 2u);
+  CHECK_EQUAL(restrictions[1], make("0110"));
+  MESSAGE("conjunctions stop at an empty result");
+  lookups.clear();
+  hits = visit(bitmap_evaluator{lookup}, conjunction{pc, pa, pb});
+  REQUIRE(hits);
+  CHECK(all<0>(*hits));
+  REQUIRE_EQUAL(lookups.size(), 1u);
+  CHECK(lookups[0] == pc);
+  MESSAGE("disjunctions and negations");
+  hits = visit(bitmap_evaluator{lookup}, disjunction{pa, pb});
+  REQUIRE(hits);
+  CHECK_EQUAL(*hits, make("1110"));
+  hits = visit(bitmap_evaluator{lookup}, negation{pa});
+  REQUIRE(hits);
+  CHECK_EQUAL(*hits, make("1001"));
+}
@@ -0,0 +1,100 @@
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/partition_cache.hpp"
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/detail/system.hpp"
+#include "vast/detail/thread_pool.hpp"
+
+#define SUITE index
+#include "test.hpp"
+
+using namespace vast;
+
+namespace {
+
+struct fixture {
+  fixture() {
+    dir = path{"/tmp/vast-unit-test-partition-cache"}
+            / std::to_string(detail::process_id());
+    t = count_type{};
+    t.name() = "foo";
+    // Create three sealed partitions with identical contents.
+    for (auto i = 0; i < 3; ++i) {
+      ids.push_back(uuid::random());
+      std::vector<event> events;
+      for (auto j = 0u; j < 1000; ++j) {
+        events.push_back(event::make(count{j % 100}, t));
+        events.back().id(j);
+      }
+      partition_indexer idx{pool, dir / to_string(ids.back())};
+      REQUIRE(idx.add(events));
+      REQUIRE(idx.seal());
+    }
+  }
+
+  ~fixture() {
+    rm(dir);
+  }
+
+  // Looks up a column of the partition, which materializes it.
+  void lookup(partition_cache& c, size_t i) {
+    auto p = predicate{data_extractor{t, offset{}}, equal, data{count{42}}};
+    auto hits = c.lookup(ids[i], p);
+    REQUIRE(hits);
+    CHECK_EQUAL(rank(*hits), 10u);
+  }
+
+  path dir;
+  type t;
+  std::vector<uuid> ids;
+  detail::thread_pool pool{2};
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(partition_cache_tests, fixture)
+
+TEST(partition cache footprint) {
+  partition_cache c{pool, dir, 2};
+  MESSAGE("loading a sealed partition materializes no columns");
+  REQUIRE(c.get(ids[0]));
+  CHECK_EQUAL(c.memusage(), 0u);
+  MESSAGE("lookups account for materialized columns");
+  lookup(c, 0);
+  auto one = c.memusage();
+  CHECK_GREATER(one, 0u);
+  lookup(c, 1);
+  CHECK_EQUAL(c.memusage(), 2 * one);
+  MESSAGE("the partition count still bounds the cache");
+  lookup(c, 2);
+  CHECK_EQUAL(c.size(), 2u);
+  CHECK_EQUAL(c.memusage(), 2 * one);
+  CHECK(!c.get(uuid::random()));
+}
+
+TEST(partition cache byte budget) {
+  // Measure the footprint of a partition after a lookup.
+  uint64_t one;
+  {
+    partition_cache c{pool, dir, 10};
+    lookup(c, 0);
+    one = c.memusage();
+  }
+  partition_cache c{pool, dir, 10, one + one / 2};
+  lookup(c, 0);
+  lookup(c, 1);
+  MESSAGE("the budget evicts the least recently used partition");
+  CHECK_EQUAL(c.size(), 1u);
+  CHECK_EQUAL(c.memusage(), one);
+  REQUIRE(c.pin(ids[1]));
+  MESSAGE("pinned partitions stay beyond the budget");
+  lookup(c, 2);
+  CHECK_EQUAL(c.size(), 2u);
+  CHECK_EQUAL(c.memusage(), 2 * one);
+  c.unpin(ids[1]);
+  CHECK_EQUAL(c.size(), 1u);
+  CHECK(!c.pin(ids[1]));
+  CHECK(c.pin(ids[2]));
+}
+
+FIXTURE_SCOPE_END()
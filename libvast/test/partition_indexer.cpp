@@ -0,0 +1,273 @@
+#include "vast/batch.hpp"
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/partition_indexer.hpp"
+#include "vast/schema.hpp"
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/schema.hpp"
+#include "vast/detail/system.hpp"
+#include "vast/detail/thread_pool.hpp"
+
+#define SUITE value_index
+#include "test.hpp"
+
+using namespace vast;
+
+namespace {
+
+struct fixture {
+  fixture() {
+    auto s = to<schema>(R"__(
+      type foo = record{ x: count, y: string, r: record{ b: bool } }
+    )__");
+    REQUIRE(s);
+    sch = std::move(*s);
+    foo = sch.find("foo");
+    REQUIRE(foo);
+    bar = integer_type{};
+    bar.name() = "bar";
+    for (auto i = 0u; i < 100; ++i) {
+      auto y = i % 2 == 0 ? "even" : "odd";
+      events.push_back(event::make(vector{count{i % 10}, y, vector{i < 50}},
+                                   *foo));
+      events.back().id(i);
+      events.back().timestamp(timestamp{std::chrono::seconds{i}});
+    }
+    for (auto i = 100; i < 110; ++i) {
+      events.push_back(event::make(integer{i}, bar));
+      events.back().id(i);
+      events.back().timestamp(timestamp{std::chrono::seconds{i}});
+    }
+    dir = path{"/tmp/vast-unit-test-partition-indexer"}
+            / std::to_string(detail::process_id());
+  }
+
+  ~fixture() {
+    rm(dir);
+  }
+
+  // Retrieves the size of a file.
+  size_t file_size(path const& p) {
+    file f{p};
+    size_t result = 0;
+    REQUIRE(f.open(file::read_only));
+    REQUIRE(f.size(result));
+    return result;
+  }
+
+  // Writes a string into a file.
+  void write(path const& p, std::string const& str, bool append) {
+    file f{p};
+    REQUIRE(f.open(file::write_only, append));
+    REQUIRE(f.write(str.data(), str.size()));
+  }
+
+  // Checks a sample of lookups against an indexer of all events.
+  void check_lookups(partition_indexer& idx) {
+    auto name = predicate{attribute_extractor{"type"}, equal, data{"bar"}};
+    CHECK_EQUAL(count_hits(idx, name), 10u);
+    auto x = predicate{data_extractor{*foo, offset{0}}, equal, data{count{3}}};
+    CHECK_EQUAL(count_hits(idx, x), 10u);
+    auto b = predicate{data_extractor{*foo, offset{2, 0}}, equal, data{true}};
+    CHECK_EQUAL(count_hits(idx, b), 50u);
+  }
+
+  // Counts the hits of a predicate.
+  uint64_t count_hits(partition_indexer& idx, predicate const& p) {
+    auto result = idx.lookup(p);
+    REQUIRE(result);
+    return result->empty() ? 0 : rank(*result);
+  }
+
+  schema sch;
+  type const* foo;
+  type bar;
+  std::vector<event> events;
+  path dir;
+  detail::thread_pool pool{4};
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(partition_indexer_tests, fixture)
+
+TEST(partition indexer) {
+  partition_indexer idx{pool};
+  MESSAGE("indexing in two steps");
+  auto middle = events.begin() + 60;
+  REQUIRE(idx.add(std::vector<event>(events.begin(), middle)));
+  REQUIRE(idx.add(std::vector<event>(middle, events.end())));
+  CHECK_EQUAL(idx.columns(), 6u); // name, time, x, y, r.b, and bar
+  CHECK_GREATER(idx.memusage(), 0u);
+  MESSAGE("meta data lookups");
+  auto name = predicate{attribute_extractor{"type"}, equal, data{"bar"}};
+  CHECK_EQUAL(count_hits(idx, name), 10u);
+  auto ts = data{timestamp{std::chrono::seconds{30}}};
+  auto time = predicate{attribute_extractor{"time"}, less, ts};
+  CHECK_EQUAL(count_hits(idx, time), 30u);
+  MESSAGE("data lookups");
+  auto x = predicate{data_extractor{*foo, offset{0}}, equal, data{count{3}}};
+  CHECK_EQUAL(count_hits(idx, x), 10u);
+  auto y = predicate{data_extractor{*foo, offset{1}}, equal, data{"odd"}};
+  CHECK_EQUAL(count_hits(idx, y), 50u);
+  auto b = predicate{data_extractor{*foo, offset{2, 0}}, equal, data{true}};
+  CHECK_EQUAL(count_hits(idx, b), 50u);
+  auto i = predicate{data_extractor{bar, offset{}}, greater_equal,
+                     data{integer{105}}};
+  CHECK_EQUAL(count_hits(idx, i), 5u);
+  MESSAGE("unknown columns have no hits");
+  auto baz = type{real_type{}};
+  baz.name() = "baz";
+  auto r = predicate{data_extractor{baz, offset{}}, equal, data{4.2}};
+  CHECK_EQUAL(count_hits(idx, r), 0u);
+  MESSAGE("out-of-order IDs fail");
+  CHECK(!idx.add(std::vector<event>(events.begin(), events.begin() + 1)));
+}
+
+TEST(partition indexer batches) {
+  batch::writer writer{compression::null};
+  for (auto i = 0u; i < 60; ++i)
+    REQUIRE(writer.write(events[i]));
+  auto first = writer.seal();
+  first.ids(0, 60);
+  for (auto i = 60u; i < events.size(); ++i)
+    REQUIRE(writer.write(events[i]));
+  auto second = writer.seal();
+  second.ids(60, events.size());
+  MESSAGE("indexing columnar batches");
+  partition_indexer idx{pool};
+  REQUIRE(idx.add(first));
+  REQUIRE(idx.add(second));
+  CHECK_EQUAL(idx.columns(), 6u);
+  check_lookups(idx);
+  auto ts = data{timestamp{std::chrono::seconds{30}}};
+  auto time = predicate{attribute_extractor{"time"}, less, ts};
+  CHECK_EQUAL(count_hits(idx, time), 30u);
+  MESSAGE("invalid IDs leave the index unchanged");
+  CHECK(!idx.add(first));
+  CHECK(!idx.add(std::vector<event>(events.begin(), events.begin() + 1)));
+  check_lookups(idx);
+}
+
+TEST(partition indexer expressions) {
+  partition_indexer idx{pool};
+  REQUIRE(idx.add(events));
+  auto x = predicate{data_extractor{*foo, offset{0}}, equal, data{count{3}}};
+  auto b = predicate{data_extractor{*foo, offset{2, 0}}, equal, data{true}};
+  MESSAGE("columns gather statistics");
+  auto stats = idx.statistics(x);
+  REQUIRE(stats);
+  CHECK_EQUAL(stats->count(), 100u);
+  CHECK_EQUAL(stats->distinct(), 10u);
+  auto unknown = type{real_type{}};
+  unknown.name() = "baz";
+  auto r = predicate{data_extractor{unknown, offset{}}, equal, data{4.2}};
+  CHECK(!idx.statistics(r));
+  MESSAGE("expressions combine restricted lookups");
+  auto hits = idx.lookup(expression{conjunction{b, x}});
+  REQUIRE(hits);
+  CHECK_EQUAL(rank(*hits), 5u);
+  hits = idx.lookup(expression{conjunction{x, negation{b}}});
+  REQUIRE(hits);
+  CHECK_EQUAL(rank(*hits), 5u);
+  hits = idx.lookup(expression{disjunction{x, b}});
+  REQUIRE(hits);
+  CHECK_EQUAL(rank(*hits), 55u);
+  MESSAGE("an empty restriction yields no hits");
+  auto empty = bitmap{};
+  hits = idx.lookup(b, &empty);
+  REQUIRE(hits);
+  CHECK(all<0>(*hits));
+}
+
+TEST(partition indexer persistence) {
+  auto middle = events.begin() + 60;
+  partition_indexer idx{pool, dir};
+  REQUIRE(idx.add(std::vector<event>(events.begin(), middle)));
+  REQUIRE(idx.flush());
+  auto first = file_size(dir / "log");
+  MESSAGE("flushes append only new values");
+  REQUIRE(idx.add(std::vector<event>(middle, events.end())));
+  REQUIRE(idx.flush());
+  auto second = file_size(dir / "log");
+  CHECK_GREATER(second, first);
+  CHECK_LESS(second - first, first);
+  REQUIRE(idx.flush());
+  CHECK_EQUAL(file_size(dir / "log"), second);
+  MESSAGE("loading replays the log");
+  partition_indexer replayed{pool, dir};
+  REQUIRE(replayed.load());
+  CHECK_EQUAL(replayed.columns(), idx.columns());
+  check_lookups(replayed);
+  MESSAGE("sealing compacts into a single file");
+  REQUIRE(replayed.seal());
+  CHECK(exists(dir / "index"));
+  CHECK(!exists(dir / "log"));
+  MESSAGE("sealed partitions load columns on first access");
+  partition_indexer sealed{pool, dir};
+  REQUIRE(sealed.load());
+  CHECK_EQUAL(sealed.columns(), idx.columns());
+  CHECK_EQUAL(sealed.resident_columns(), 0u);
+  CHECK_EQUAL(sealed.memusage(), 0u);
+  auto x = predicate{data_extractor{*foo, offset{0}}, equal, data{count{3}}};
+  REQUIRE(sealed.statistics(x));
+  CHECK_EQUAL(sealed.statistics(x)->count(), 100u);
+  auto y = predicate{data_extractor{*foo, offset{1}}, equal, data{"odd"}};
+  CHECK_EQUAL(count_hits(sealed, y), 50u);
+  CHECK_EQUAL(sealed.resident_columns(), 1u);
+  check_lookups(sealed);
+  CHECK_EQUAL(sealed.resident_columns(), 4u);
+  MESSAGE("adding to a sealed partition loads the affected columns");
+  auto more = event::make(integer{110}, bar);
+  more.id(110);
+  more.timestamp(timestamp{std::chrono::seconds{110}});
+  REQUIRE(sealed.add(std::vector<event>{more}));
+  CHECK_EQUAL(sealed.resident_columns(), 6u);
+  auto name = predicate{attribute_extractor{"type"}, equal, data{"bar"}};
+  CHECK_EQUAL(count_hits(sealed, name), 11u);
+}
+
+TEST(partition indexer torn log) {
+  auto middle = events.begin() + 60;
+  {
+    partition_indexer idx{pool, dir};
+    REQUIRE(idx.add(std::vector<event>(events.begin(), middle)));
+    REQUIRE(idx.flush());
+  }
+  MESSAGE("replay ignores log bytes beyond the size in the manifest");
+  auto size = file_size(dir / "log");
+  write(dir / "log", std::string(100, '\xff'), true);
+  partition_indexer idx{pool, dir};
+  REQUIRE(idx.load());
+  auto x = predicate{data_extractor{*foo, offset{0}}, equal, data{count{3}}};
+  CHECK_EQUAL(count_hits(idx, x), 6u);
+  MESSAGE("the next flush overwrites the torn bytes");
+  REQUIRE(idx.add(std::vector<event>(middle, events.end())));
+  REQUIRE(idx.flush());
+  CHECK_GREATER(file_size(dir / "log"), size);
+  partition_indexer replayed{pool, dir};
+  REQUIRE(replayed.load());
+  check_lookups(replayed);
+}
+
+TEST(partition indexer leftover log) {
+  partition_indexer idx{pool, dir};
+  REQUIRE(idx.add(events));
+  REQUIRE(idx.flush());
+  auto log = load_contents(dir / "log");
+  auto manifest = load_contents(dir / "manifest");
+  REQUIRE(log);
+  REQUIRE(manifest);
+  REQUIRE(idx.seal());
+  MESSAGE("a crash after sealing leaves the log behind");
+  write(dir / "log", *log, false);
+  write(dir / "manifest", *manifest, false);
+  partition_indexer sealed{pool, dir};
+  REQUIRE(sealed.load());
+  CHECK_EQUAL(sealed.columns(), idx.columns());
+  MESSAGE("replay skips the values that the sealed indexes contain");
+  check_lookups(sealed);
+  auto y = predicate{data_extractor{*foo, offset{1}}, equal, data{"odd"}};
+  CHECK_EQUAL(count_hits(sealed, y), 50u);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,117 @@
+#include "vast/partition_scheduler.hpp"
+
+#define SUITE index
+#include "test.hpp"
+
+using namespace vast;
+
+namespace {
+
+using scheduler = partition_scheduler;
+
+struct fixture {
+  fixture() {
+    for (auto i = 0; i < 6; ++i) {
+      auto latest = timestamp{std::chrono::hours{i}};
+      partitions.push_back({uuid::random(), latest});
+    }
+  }
+
+  // Selects a subset of the partitions.
+  std::vector<scheduler::candidate> select(std::vector<size_t> const& xs) {
+    std::vector<scheduler::candidate> result;
+    for (auto x : xs)
+      result.push_back(partitions[x]);
+    return result;
+  }
+
+  std::vector<scheduler::candidate> partitions;
+  uuid q0 = uuid::random();
+  uuid q1 = uuid::random();
+  uuid q2 = uuid::random();
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(partition_scheduler_tests, fixture)
+
+TEST(partition scheduler order) {
+  scheduler s{1};
+  REQUIRE(s.add(q0, 0, scheduler::order::oldest_first, select({2, 0, 1})));
+  CHECK(!s.add(q0, 0, scheduler::order::oldest_first, select({3})));
+  CHECK_EQUAL(s.pending(), 3u);
+  for (auto i = 0u; i < 3; ++i) {
+    auto t = s.next();
+    REQUIRE(t);
+    CHECK(!s.next()); // All slots are busy.
+    CHECK(t->query == q0);
+    CHECK(t->partition == partitions[i].id);
+    CHECK_EQUAL(s.complete(*t), i == 2);
+  }
+  MESSAGE("interactive queries visit recent partitions first");
+  REQUIRE(s.add(q1, 0, scheduler::order::newest_first, select({3, 5, 4})));
+  for (auto i = 5u; i >= 3; --i) {
+    auto t = s.next();
+    REQUIRE(t);
+    CHECK(t->partition == partitions[i].id);
+    s.complete(*t);
+  }
+  CHECK(!s.next());
+  CHECK_EQUAL(s.running(), 0u);
+  CHECK_EQUAL(s.pending(), 0u);
+}
+
+TEST(partition scheduler priorities) {
+  scheduler s{2};
+  auto order = scheduler::order::oldest_first;
+  REQUIRE(s.add(q0, 0, order, select({0, 1, 2, 3, 4, 5})));
+  auto t0 = s.next();
+  REQUIRE(t0);
+  MESSAGE("a query with higher priority takes the next free slot");
+  REQUIRE(s.add(q1, 1, order, select({4, 5})));
+  auto t1 = s.next();
+  REQUIRE(t1);
+  CHECK(t1->query == q1);
+  CHECK(!s.next());
+  s.complete(*t0);
+  auto t2 = s.next();
+  REQUIRE(t2);
+  CHECK(t2->query == q1);
+  CHECK(s.complete(*t1) == false);
+  CHECK(s.complete(*t2));
+  MESSAGE("the low-priority query resumes afterwards");
+  auto t3 = s.next();
+  REQUIRE(t3);
+  CHECK(t3->query == q0);
+  CHECK(t3->partition == partitions[1].id);
+}
+
+TEST(partition scheduler fairness) {
+  scheduler s{1};
+  auto order = scheduler::order::oldest_first;
+  REQUIRE(s.add(q0, 0, order, select({0, 1, 2, 3, 4, 5})));
+  for (auto i = 0; i < 3; ++i)
+    s.complete(*s.next());
+  MESSAGE("a new query of equal priority alternates with the old one");
+  REQUIRE(s.add(q1, 0, order, select({0, 1, 2})));
+  std::vector<uuid> queries;
+  while (auto t = s.next()) {
+    queries.push_back(t->query);
+    s.complete(*t);
+  }
+  REQUIRE_EQUAL(queries.size(), 6u);
+  CHECK(queries[0] == q0);
+  CHECK(queries[1] == q1);
+  CHECK(queries[2] == q0);
+  CHECK(queries[3] == q1);
+  MESSAGE("cancellation drops pending evaluations");
+  REQUIRE(s.add(q2, 0, order, select({0, 1, 2})));
+  auto t = s.next();
+  REQUIRE(t);
+  CHECK_EQUAL(s.cancel(q2), 2u);
+  CHECK_EQUAL(s.pending(), 0u);
+  CHECK(s.complete(*t));
+  CHECK(!s.next());
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,91 @@
+#include "vast/error.hpp"
+#include "vast/predicate_cache.hpp"
+
+#define SUITE expression
+#include "test.hpp"
+
+using namespace vast;
+
+namespace {
+
+struct fixture {
+  fixture() {
+    p0 = predicate{key_extractor{{"x"}}, equal, data{integer{42}}};
+    p1 = predicate{key_extractor{{"y"}}, less, data{count{7}}};
+    hits.append_bits(false, 10);
+    hits.append_bit(true);
+  }
+
+  // Computes a result and counts the invocations.
+  expected<bitmap> compute() {
+    ++computations;
+    return hits;
+  }
+
+  predicate p0;
+  predicate p1;
+  bitmap hits;
+  size_t computations = 0;
+  uuid u0 = uuid::random();
+  uuid u1 = uuid::random();
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(predicate_cache_tests, fixture)
+
+TEST(predicate cache) {
+  predicate_cache cache{1 << 20};
+  auto f = [&] { return compute(); };
+  MESSAGE("sealed partitions get cached");
+  auto x = cache.get(u0, p0, true, f);
+  REQUIRE(x);
+  CHECK_EQUAL(*x, hits);
+  x = cache.get(u0, p0, true, f);
+  REQUIRE(x);
+  CHECK_EQUAL(*x, hits);
+  CHECK_EQUAL(computations, 1u);
+  CHECK_EQUAL(cache.hits(), 1u);
+  CHECK_EQUAL(cache.misses(), 1u);
+  MESSAGE("keys distinguish partitions and predicates");
+  cache.get(u1, p0, true, f);
+  cache.get(u0, p1, true, f);
+  CHECK_EQUAL(computations, 3u);
+  CHECK_EQUAL(cache.size(), 3u);
+  CHECK_EQUAL(cache.bytes(), 3 * hits.memusage());
+  MESSAGE("active partitions bypass the cache");
+  cache.get(u1, p1, false, f);
+  cache.get(u1, p1, false, f);
+  CHECK_EQUAL(computations, 5u);
+  CHECK_EQUAL(cache.size(), 3u);
+  CHECK_EQUAL(cache.misses(), 3u);
+  MESSAGE("failures do not get cached");
+  auto failure = [] { return expected<bitmap>{fail("no bitmap")}; };
+  CHECK(!cache.get(u1, p1, true, failure));
+  CHECK_EQUAL(cache.size(), 3u);
+  MESSAGE("invalidating a partition");
+  CHECK_EQUAL(cache.erase(u0), 2u);
+  CHECK_EQUAL(cache.erase(u0), 0u);
+  CHECK_EQUAL(cache.size(), 1u);
+}
+
+TEST(predicate cache eviction) {
+  predicate_cache cache{2 * hits.memusage()};
+  auto f = [&] { return compute(); };
+  cache.get(u0, p0, true, f);
+  cache.get(u0, p1, true, f);
+  cache.get(u0, p0, true, f);
+  cache.get(u1, p0, true, f);
+  CHECK_EQUAL(cache.size(), 2u);
+  MESSAGE("the least recently used result got evicted");
+  cache.get(u0, p0, true, f);
+  CHECK_EQUAL(computations, 3u);
+  cache.get(u0, p1, true, f);
+  CHECK_EQUAL(computations, 4u);
+  MESSAGE("eviction keeps the partition bookkeeping consistent");
+  CHECK_EQUAL(cache.erase(u0), 2u);
+  CHECK_EQUAL(cache.erase(u1), 0u);
+  CHECK_EQUAL(cache.size(), 0u);
+}
+
+FIXTURE_SCOPE_END()
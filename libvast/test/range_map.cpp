@@ -1,3 +1,4 @@
+#include "vast/detail/flat_range_map.hpp"
 #include "vast/detail/range_map.hpp"
 #include "vast/load.hpp"
 #include "vast/save.hpp"
@@ -182,3 +183,58 @@ TEST(range_map serialization) {
   REQUIRE(i);
   CHECK(*i == 'a');
 }
+
+TEST(flat_range_map) {
+  range_map<size_t, char> rm;
+  rm.insert(50, 60, 'a');
+  rm.insert(80, 90, 'b');
+  rm.insert(20, 30, 'c');
+  flat_range_map<size_t, char> frm{rm};
+  REQUIRE_EQUAL(frm.size(), 3u);
+  MESSAGE("lookup");
+  for (auto p : {0, 19, 30, 49, 60, 79, 90, 1000})
+    CHECK(!frm.lookup(p));
+  auto i = frm.lookup(20);
+  REQUIRE(i);
+  CHECK_EQUAL(*i, 'c');
+  i = frm.lookup(59);
+  REQUIRE(i);
+  CHECK_EQUAL(*i, 'a');
+  auto t = frm.find(85);
+  CHECK_EQUAL(std::get<0>(t), 80u);
+  CHECK_EQUAL(std::get<1>(t), 90u);
+  REQUIRE(std::get<2>(t));
+  CHECK_EQUAL(*std::get<2>(t), 'b');
+  MESSAGE("injection");
+  CHECK(!frm.inject(55, 65, 'a'));
+  CHECK(!frm.inject(10, 21, 'c'));
+  CHECK(frm.inject(30, 40, 'c'));
+  CHECK_EQUAL(frm.size(), 3u);
+  CHECK(frm.inject(60, 80, 'b'));
+  CHECK_EQUAL(frm.size(), 3u);
+  CHECK(frm.inject(40, 50, 'a'));
+  CHECK_EQUAL(frm.size(), 3u);
+  CHECK(frm.inject(100, 110, 'd'));
+  CHECK(frm.inject(90, 100, 'b'));
+  REQUIRE_EQUAL(frm.size(), 4u);
+  t = frm.find(95);
+  CHECK_EQUAL(std::get<0>(t), 60u);
+  CHECK_EQUAL(std::get<1>(t), 100u);
+  i = frm.lookup(105);
+  REQUIRE(i);
+  CHECK_EQUAL(*i, 'd');
+  MESSAGE("erasure");
+  CHECK(frm.erase(45));
+  CHECK(!frm.lookup(55));
+  CHECK(!frm.erase(45));
+  CHECK_EQUAL(frm.size(), 3u);
+  MESSAGE("serialization");
+  std::vector<char> buf;
+  save(buf, frm);
+  flat_range_map<size_t, char> copy;
+  load(buf, copy);
+  REQUIRE_EQUAL(copy.size(), 3u);
+  i = copy.lookup(25);
+  REQUIRE(i);
+  CHECK_EQUAL(*i, 'c');
+}
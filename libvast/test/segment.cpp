@@ -0,0 +1,137 @@
+#include "vast/event.hpp"
+#include "vast/segment.hpp"
+#include "vast/concept/printable/vast/event.hpp"
+#include "vast/detail/system.hpp"
+#include "vast/detail/thread_pool.hpp"
+
+#define SUITE segment
+#include "test.hpp"
+
+using namespace vast;
+
+TEST(memory-mapped segment) {
+  auto t = type{integer_type{}};
+  t.name() = "foo";
+  std::vector<event> events;
+  std::vector<batch> batches;
+  for (auto i = 0; i < 3; ++i) {
+    batch::writer writer{compression::lz4, 100};
+    for (auto j = 0; j < 500; ++j) {
+      events.push_back(event::make(integer{i * 500 + j}, t));
+      events.back().id(i * 500 + j);
+      REQUIRE(writer.write(events.back()));
+    }
+    batches.push_back(writer.seal());
+    REQUIRE(batches.back().ids(i * 500, (i + 1) * 500));
+  }
+  path dir = "/tmp/vast-unit-test-segment";
+  auto filename = dir / std::to_string(detail::process_id());
+  MESSAGE("write segment");
+  REQUIRE(segment::write(filename, batches));
+  MESSAGE("map segment");
+  auto s = segment::map(filename);
+  REQUIRE(s);
+  REQUIRE_EQUAL(s->batches().size(), 3u);
+  CHECK_EQUAL(s->batches()[1].events(), 500u);
+  CHECK(s->advise(mapped_file::random));
+  CHECK(s->batches()[1].bytes() != batches[1].bytes());
+  std::vector<event> xs;
+  for (auto& b : s->batches()) {
+    auto ys = batch::reader{b}.read();
+    REQUIRE(ys);
+    xs.insert(xs.end(), ys->begin(), ys->end());
+  }
+  CHECK(xs == events);
+  MESSAGE("batches keep the mapping alive");
+  auto b = s->batches().back();
+  s = segment{};
+  CHECK(s->batches().empty());
+  CHECK(rm(dir));
+  bitmap ids;
+  ids.append_bits(false, 1400);
+  ids.append_bit(true);
+  auto ys = batch::reader{b}.read(ids);
+  REQUIRE(ys);
+  REQUIRE_EQUAL(ys->size(), 1u);
+  CHECK_EQUAL(ys->front(), events[1400]);
+}
+
+TEST(point lookups) {
+  auto t = type{integer_type{}};
+  t.name() = "foo";
+  std::vector<event> events;
+  std::vector<batch> batches;
+  for (auto i = 0; i < 4; ++i) {
+    batch::writer writer{compression::null};
+    for (auto j = 0; j < 100; ++j) {
+      events.push_back(event::make(integer{i * 100 + j}, t));
+      events.back().id(1000 + i * 100 + j);
+      REQUIRE(writer.write(events.back()));
+    }
+    batches.push_back(writer.seal());
+    REQUIRE(batches.back().ids(1000 + i * 100, 1000 + (i + 1) * 100));
+  }
+  path dir = "/tmp/vast-unit-test-segment-reader";
+  auto filename = dir / std::to_string(detail::process_id());
+  REQUIRE(segment::write(filename, batches));
+  MESSAGE("read the index");
+  segment::reader reader{filename};
+  REQUIRE(reader.open());
+  REQUIRE_EQUAL(reader.index().size(), 4u);
+  CHECK_EQUAL(reader.index()[2].first, 1200u);
+  CHECK_EQUAL(reader.index()[2].last, 1299u);
+  MESSAGE("look up a single event");
+  auto b = reader.read(event_id{1234});
+  REQUIRE(b);
+  CHECK_EQUAL(b->id_range().first, 1200u);
+  CHECK(!reader.read(event_id{42}));
+  CHECK(!reader.read(event_id{1400}));
+  MESSAGE("look up a set of events");
+  bitmap ids;
+  ids.append_bits(false, 1050);
+  ids.append_bits(true, 10);
+  ids.append_bits(false, 250);
+  ids.append_bit(true);
+  auto bs = reader.read(ids);
+  REQUIRE(bs);
+  REQUIRE_EQUAL(bs->size(), 2u);
+  auto xs = batch::reader{bs->back()}.read(ids);
+  REQUIRE(xs);
+  REQUIRE_EQUAL(xs->size(), 1u);
+  CHECK_EQUAL(xs->front(), events[310]);
+  MESSAGE("bulk lookup");
+  ids.append_bits(false, 50);
+  ids.append_bits(true, 5);
+  detail::thread_pool pool{2};
+  std::vector<event> hits;
+  auto consume = [&](std::vector<event>& ys) -> error {
+    hits.insert(hits.end(), ys.begin(), ys.end());
+    return {};
+  };
+  CHECK(!reader.lookup(ids, pool, consume, 1));
+  REQUIRE_EQUAL(hits.size(), 16u);
+  CHECK_EQUAL(hits[0], events[50]);
+  CHECK_EQUAL(hits[10], events[310]);
+  CHECK_EQUAL(hits[15], events[365]);
+  MESSAGE("aborting a bulk lookup");
+  auto calls = 0;
+  auto abort = [&](std::vector<event>&) -> error {
+    ++calls;
+    return fail("abort");
+  };
+  CHECK(reader.lookup(ids, pool, abort));
+  CHECK_EQUAL(calls, 1);
+  MESSAGE("bulk lookup from a thread of the pool");
+  detail::thread_pool single{1};
+  hits.clear();
+  auto nested = single.submit([&] {
+    return reader.lookup(ids, single, consume);
+  });
+  CHECK(!nested.get());
+  CHECK_EQUAL(hits.size(), 16u);
+  MESSAGE("mapping skips the index");
+  auto s = segment::map(filename);
+  REQUIRE(s);
+  CHECK_EQUAL(s->batches().size(), 4u);
+  CHECK(rm(dir));
+}
@@ -0,0 +1,192 @@
+#include "vast/event.hpp"
+#include "vast/segment_store.hpp"
+#include "vast/concept/printable/vast/event.hpp"
+#include "vast/detail/system.hpp"
+
+#define SUITE segment
+#include "test.hpp"
+
+using namespace vast;
+
+namespace {
+
+struct fixture {
+  fixture() {
+    auto t = type{integer_type{}};
+    t.name() = "foo";
+    for (auto i = 0; i < 10; ++i) {
+      batch::writer writer{compression::null};
+      for (auto j = 0; j < 100; ++j) {
+        auto id = i * 100 + j;
+        events.push_back(event::make(integer{id}, t));
+        events.back().id(id);
+        events.back().timestamp(timestamp{std::chrono::hours{24 * i}});
+        REQUIRE(writer.write(events.back()));
+      }
+      batches.push_back(writer.seal());
+      REQUIRE(batches.back().ids(i * 100, (i + 1) * 100));
+    }
+    dir = path{"/tmp/vast-unit-test-segment-store"}
+            / std::to_string(detail::process_id());
+  }
+
+  ~fixture() {
+    rm(dir);
+  }
+
+  // Looks up a single event.
+  std::vector<event> lookup(segment_store& store, event_id id) {
+    bitmap ids;
+    ids.append_bits(false, id);
+    ids.append_bit(true);
+    auto bs = store.get(ids);
+    REQUIRE(bs);
+    std::vector<event> result;
+    for (auto& b : *bs) {
+      auto xs = batch::reader{b}.read(ids);
+      REQUIRE(xs);
+      result.insert(result.end(), xs->begin(), xs->end());
+    }
+    return result;
+  }
+
+  std::vector<event> events;
+  std::vector<batch> batches;
+  path dir;
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(segment_store_tests, fixture)
+
+TEST(segment store) {
+  auto max_size = batches[0].size() * 7 / 2;
+  segment_store store{dir, max_size};
+  for (auto& b : batches)
+    REQUIRE(store.put(b));
+  MESSAGE("lookups consider batches in flight and buffered batches");
+  auto xs = lookup(store, 750);
+  REQUIRE_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(xs[0], events[750]);
+  xs = lookup(store, 950);
+  REQUIRE_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(xs[0], events[950]);
+  MESSAGE("full segments get written");
+  REQUIRE(store.sync());
+  CHECK_EQUAL(store.segments().size(), 3u);
+  CHECK_EQUAL(store.segments()[1].first, 300u);
+  CHECK_EQUAL(store.segments()[1].last, 599u);
+  xs = lookup(store, 420);
+  REQUIRE_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(xs[0], events[420]);
+  CHECK(lookup(store, 1000).empty());
+  REQUIRE(store.flush());
+  REQUIRE(store.sync());
+  CHECK_EQUAL(store.segments().size(), 4u);
+  MESSAGE("reopen replays the meta data log");
+  segment_store other{dir, max_size};
+  REQUIRE(other.open());
+  REQUIRE_EQUAL(other.segments().size(), 4u);
+  xs = lookup(other, 950);
+  REQUIRE_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(xs[0], events[950]);
+}
+
+TEST(segment store torn meta data) {
+  auto max_size = batches[0].size() * 3 / 2;
+  segment_store store{dir, max_size};
+  for (auto i = 0; i < 4; ++i)
+    REQUIRE(store.put(batches[i]));
+  REQUIRE(store.flush());
+  REQUIRE(store.sync());
+  REQUIRE_EQUAL(store.segments().size(), 4u);
+  MESSAGE("simulate a crash in the middle of an append");
+  {
+    file f{dir / "meta"};
+    REQUIRE(f.open(file::write_only, true));
+    char const torn[] = {0, 0, 4, 2, 'x'};
+    REQUIRE(f.write(torn, sizeof(torn)));
+  }
+  segment_store other{dir, max_size};
+  REQUIRE(other.open());
+  CHECK_EQUAL(other.segments().size(), 4u);
+  MESSAGE("appends after reopening remain visible");
+  REQUIRE(other.put(batches[4]));
+  REQUIRE(other.flush());
+  REQUIRE(other.sync());
+  segment_store third{dir, max_size};
+  REQUIRE(third.open());
+  REQUIRE_EQUAL(third.segments().size(), 5u);
+  auto xs = lookup(third, 420);
+  REQUIRE_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(xs[0], events[420]);
+}
+
+TEST(segment compaction) {
+  segment_store tiny{dir, 1 << 20};
+  for (auto& b : batches) {
+    REQUIRE(tiny.put(b));
+    REQUIRE(tiny.flush());
+  }
+  REQUIRE(tiny.sync());
+  REQUIRE_EQUAL(tiny.segments().size(), 10u);
+  MESSAGE("merging runs of segments that fit into the maximum size");
+  segment_store store{dir, tiny.segments()[0].bytes * 7 / 2};
+  REQUIRE(store.open());
+  CHECK_EQUAL(lookup(store, 0).size(), 1u);
+  CHECK_EQUAL(lookup(store, 150).size(), 1u);
+  CHECK_EQUAL(store.open_segments(), 2u);
+  auto removed = store.compact();
+  REQUIRE(removed);
+  CHECK_EQUAL(*removed, 9u);
+  CHECK_EQUAL(store.open_segments(), 0u);
+  REQUIRE_EQUAL(store.segments().size(), 4u);
+  CHECK_EQUAL(store.segments()[0].first, 0u);
+  CHECK_EQUAL(store.segments()[0].last, 299u);
+  for (auto id : {0, 299, 300, 777, 999}) {
+    auto xs = lookup(store, id);
+    REQUIRE_EQUAL(xs.size(), 1u);
+    CHECK_EQUAL(xs[0], events[id]);
+  }
+  CHECK_EQUAL(store.open_segments(), 4u);
+  MESSAGE("lookups keep a bounded number of segments open");
+  segment_store bounded{dir, 1 << 20, 2};
+  REQUIRE(bounded.open());
+  for (auto id : {0, 300, 777})
+    CHECK_EQUAL(lookup(bounded, id).size(), 1u);
+  CHECK_EQUAL(bounded.open_segments(), 2u);
+  MESSAGE("compacting again has no effect");
+  removed = store.compact();
+  REQUIRE(removed);
+  CHECK_EQUAL(*removed, 0u);
+  MESSAGE("compaction rewrites the meta data log");
+  segment_store other{dir, 1 << 20};
+  REQUIRE(other.open());
+  CHECK_EQUAL(other.segments().size(), 4u);
+}
+
+TEST(segment retention) {
+  auto max_size = batches[0].size() * 5 / 2;
+  segment_store store{dir, max_size};
+  for (auto& b : batches)
+    REQUIRE(store.put(b));
+  REQUIRE(store.flush());
+  REQUIRE(store.sync());
+  REQUIRE_EQUAL(store.segments().size(), 5u);
+  CHECK_EQUAL(lookup(store, 42).size(), 1u);
+  CHECK_EQUAL(lookup(store, 420).size(), 1u);
+  CHECK_EQUAL(store.open_segments(), 2u);
+  auto expired = store.expire(timestamp{std::chrono::hours{24 * 4}});
+  REQUIRE(expired);
+  REQUIRE_EQUAL(expired->size(), 2u);
+  CHECK_EQUAL(expired->back().last, 399u);
+  REQUIRE_EQUAL(store.segments().size(), 3u);
+  CHECK_EQUAL(store.open_segments(), 1u);
+  CHECK(lookup(store, 42).empty());
+  CHECK_EQUAL(lookup(store, 420).size(), 1u);
+  segment_store other{dir, max_size};
+  REQUIRE(other.open());
+  CHECK_EQUAL(other.segments().size(), 3u);
+}
+
+FIXTURE_SCOPE_END()
@@ -0,0 +1,27 @@
+#include <atomic>
+
+#include "vast/detail/thread_pool.hpp"
+
+#define SUITE detail
+#include "test.hpp"
+
+using namespace vast::detail;
+
+TEST(thread_pool) {
+  std::atomic<int> calls{0};
+  std::vector<std::future<int>> results;
+  {
+    thread_pool pool{3};
+    CHECK_EQUAL(pool.size(), 3u);
+    for (auto i = 0; i < 100; ++i)
+      results.push_back(pool.submit([&calls, i] { ++calls; return i * i; }));
+    CHECK_EQUAL(results[10].get(), 100);
+    CHECK(!pool.owns_current_thread());
+    CHECK(pool.submit([&] { return pool.owns_current_thread(); }).get());
+    pool.submit([&calls] { ++calls; });
+  }
+  MESSAGE("the destructor executes all pending tasks");
+  CHECK_EQUAL(calls.load(), 101);
+  for (auto i = 11; i < 100; ++i)
+    CHECK_EQUAL(results[i].get(), i * i);
+}
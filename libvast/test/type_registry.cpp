@@ -0,0 +1,37 @@
+#include "vast/load.hpp"
+#include "vast/save.hpp"
+#include "vast/type_registry.hpp"
+
+#define SUITE type
+#include "test.hpp"
+
+using namespace vast;
+
+TEST(type registry) {
+  type_registry registry;
+  auto t0 = type{integer_type{}};
+  t0.name() = "foo";
+  auto t2 = type{integer_type{}};
+  t2.name() = "foo";
+  auto t1 = type{record_type{{"x", count_type{}}, {"y", string_type{}}}};
+  MESSAGE("register types");
+  auto before = registry.snapshot();
+  CHECK_EQUAL(registry.add(t0), 0u);
+  CHECK_EQUAL(registry.add(t1), 1u);
+  CHECK_EQUAL(registry.add(t2), 0u);
+  CHECK_EQUAL(registry.size(), 2u);
+  MESSAGE("lookup types");
+  auto types = registry.snapshot();
+  REQUIRE(type_registry::lookup(types, 1));
+  CHECK(*type_registry::lookup(types, 1) == t1);
+  CHECK(!type_registry::lookup(types, 2));
+  CHECK(!type_registry::lookup(before, 0));
+  MESSAGE("save and load");
+  std::vector<char> buf;
+  REQUIRE(save(buf, registry));
+  type_registry restored;
+  REQUIRE(load(buf, restored));
+  CHECK_EQUAL(restored.size(), 2u);
+  CHECK_EQUAL(restored.add(t1), 1u);
+  CHECK_EQUAL(restored.add(type{boolean_type{}}), 2u);
+}
@@ -166,6 +166,42 @@ TEST(timestamp) {
   CHECK(to_string(*eighteen) == "000101");
 }
 
+TEST(timestamp checkpoints) {
+  timestamp_index idx;
+  auto ts = [](auto str) {
+    auto t = to<timestamp>("2014-01-16+05:30:"s + str);
+    REQUIRE(t);
+    return *t;
+  };
+  MESSAGE("push_back");
+  REQUIRE(idx.push_back(ts("12")));
+  REQUIRE(idx.push_back(ts("15")));
+  REQUIRE(idx.push_back(ts("15")));
+  REQUIRE(idx.push_back(ts("18")));
+  REQUIRE(idx.push_back(ts("13"))); // out of order
+  REQUIRE(idx.push_back(ts("19")));
+  REQUIRE(idx.push_back(ts("20")));
+  CHECK_EQUAL(idx.checkpoints(), 5u);
+  MESSAGE("lookup");
+  CHECK_EQUAL(to_string(*idx.lookup(equal, ts("15"))), "0110000");
+  CHECK_EQUAL(to_string(*idx.lookup(equal, ts("13"))), "0000100");
+  CHECK_EQUAL(to_string(*idx.lookup(not_equal, ts("13"))), "1111011");
+  CHECK_EQUAL(to_string(*idx.lookup(less, ts("15"))), "1000100");
+  CHECK_EQUAL(to_string(*idx.lookup(less_equal, ts("18"))), "1111100");
+  CHECK_EQUAL(to_string(*idx.lookup(greater_equal, ts("18"))), "0001011");
+  CHECK_EQUAL(to_string(*idx.lookup(greater, ts("20"))), "0000000");
+  auto e = idx.lookup(in, ts("15"));
+  REQUIRE(!e);
+  CHECK(e.error() == ec::unsupported_operator);
+  MESSAGE("serialization");
+  std::vector<char> buf;
+  save(buf, idx);
+  timestamp_index idx2;
+  load(buf, idx2);
+  CHECK_EQUAL(idx2.checkpoints(), 5u);
+  CHECK_EQUAL(to_string(*idx2.lookup(less, ts("15"))), "1000100");
+}
+
 TEST(string) {
   string_index idx{100};
   MESSAGE("push_back");
@@ -353,6 +389,32 @@ TEST(container) {
   CHECK_EQUAL(to_string(*idx2.lookup(in, "bar")), "10110001");
 }
 
+TEST(append) {
+  std::vector<data> xs{"foo", "bar", "foo", "baz", "foo"};
+  std::vector<event_id> ids{0, 1, 2, 5, 9};
+  string_index expected;
+  for (auto i = 0u; i < xs.size(); ++i)
+    REQUIRE(expected.push_back(xs[i], ids[i]));
+  MESSAGE("runs and gaps");
+  string_index idx;
+  REQUIRE(idx.append(xs, ids));
+  CHECK_EQUAL(idx.offset(), 10u);
+  CHECK_EQUAL(to_string(*idx.lookup(equal, "foo")), "1010000001");
+  CHECK_EQUAL(to_string(*idx.lookup(equal, "foo")),
+              to_string(*expected.lookup(equal, "foo")));
+  CHECK_EQUAL(to_string(*idx.lookup(not_equal, "bar")),
+              to_string(*expected.lookup(not_equal, "bar")));
+  MESSAGE("invalid IDs leave the index unchanged");
+  CHECK(!idx.append({"qux"}, {3}));
+  CHECK(!idx.append({"qux", "qux"}, {12, 11}));
+  CHECK_EQUAL(idx.offset(), 10u);
+  MESSAGE("containers consult the offset while appending");
+  sequence_index seq{string_type{}};
+  REQUIRE(seq.append({vector{"foo"}, vector{"bar", "foo"}}, {1, 3}));
+  CHECK_EQUAL(to_string(*seq.lookup(in, "foo")), "0101");
+  CHECK_EQUAL(to_string(*seq.lookup(in, "bar")), "0001");
+}
+
 TEST(polymorphic) {
   type t = set_type{integer_type{}}.attributes({{"max_size", "2"}});
   auto idx = value_index::make(t);
@@ -379,3 +441,12 @@ TEST(polymorphic) {
   idx = value_index::make(t);
   REQUIRE(idx);
 }
+
+TEST(memusage) {
+  auto idx = value_index::make(string_type{});
+  REQUIRE(idx);
+  auto empty = idx->memusage();
+  for (auto i = 0; i < 1000; ++i)
+    REQUIRE(idx->push_back("foo" + std::to_string(i % 10)));
+  CHECK_GREATER(idx->memusage(), empty);
+}
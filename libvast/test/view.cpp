@@ -0,0 +1,67 @@
+#include "vast/data.hpp"
+#include "vast/view.hpp"
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/address.hpp"
+#include "vast/concept/parseable/vast/subnet.hpp"
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/view.hpp"
+
+#define SUITE view
+#include "test.hpp"
+
+using namespace vast;
+using namespace std::string_literals;
+
+TEST(string view) {
+  auto str = "foobar"s;
+  auto x = string_view{str};
+  CHECK_EQUAL(x.size(), 6u);
+  CHECK(x == string_view{"foobar", 6});
+  CHECK(x != string_view{"foo", 3});
+  CHECK(string_view{"foo", 3} < x);
+  MESSAGE("high-bit bytes order like in std::string");
+  auto high = "\xe4"s;
+  CHECK(str < high);
+  CHECK(x < string_view{high});
+  CHECK(!(string_view{high} < x));
+  CHECK(x.contains(string_view{"oba", 3}));
+  CHECK(!x.contains(string_view{"baz", 3}));
+  CHECK(x.contains(string_view{}));
+  CHECK_EQUAL(to_string(x), str);
+}
+
+TEST(making and materializing views) {
+  auto xs = vector{nil, true, integer{-42}, count{42}, real{4.2}, "foo"s,
+                   *to<address>("10.0.0.1"), port{53, port::udp},
+                   vector{count{1}, "bar"s}, set{integer{1}}};
+  for (auto& x : xs)
+    CHECK_EQUAL(materialize(make_view(x)), x);
+  CHECK(is<string_view>(make_view(xs[5])));
+  CHECK(is<data const*>(make_view(xs[8])));
+}
+
+TEST(evaluation) {
+  auto str = data{"foo"s};
+  auto x = make_view(str);
+  CHECK(evaluate(x, equal, data{"foo"s}));
+  CHECK(evaluate(x, in, data{"foobar"s}));
+  CHECK(evaluate(x, not_ni, data{"bar"s}));
+  CHECK(evaluate(x, less, data{"fop"s}));
+  CHECK(evaluate(x, less, data{"\xe4"s}));
+  CHECK(!evaluate(x, greater, data{"\xe4"s}));
+  CHECK(evaluate(x, match, data{pattern{"f.o"}}));
+  CHECK(evaluate(x, in, data{set{"foo"s, "bar"s}}));
+  CHECK(!evaluate(x, equal, data{count{42}}));
+  auto addr = data{*to<address>("10.0.0.1")};
+  CHECK(evaluate(make_view(addr), in, data{*to<subnet>("10.0.0.0/8")}));
+  auto xs = data{vector{count{1}, count{2}}};
+  CHECK(evaluate(make_view(xs), ni, data{count{2}}));
+}
+
+TEST(printable) {
+  auto str = data{"f\"oo"s};
+  CHECK_EQUAL(to_string(make_view(str)), "\"f\\\"oo\"");
+  CHECK_EQUAL(to_string(data_view{count{42}}), "42");
+  auto xs = data{vector{count{1}, nil}};
+  CHECK_EQUAL(to_string(make_view(xs)), "[1, nil]");
+}
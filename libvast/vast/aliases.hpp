@@ -8,6 +8,9 @@
 #include <set>
 #include <vector>
 
+#include "vast/detail/flat_map.hpp"
+#include "vast/detail/flat_set.hpp"
+
 namespace vast {
 
 // -- data -------------------------------------------------------------------
@@ -22,11 +25,12 @@ using real = double;
 /// A random-access sequence of data.
 using vector = std::vector<data>;
 
-/// A mathematical set where each element is ::data.
-using set = std::set<data>;
+/// A mathematical set where each element is ::data, stored as sorted vector.
+using set = detail::flat_set<data>;
 
-/// An associative array with ::data as both key and value.
-using table = std::map<data, data>;
+/// An associative array with ::data as both key and value, stored as sorted
+/// vector of key-value pairs.
+using table = detail::flat_map<data, data>;
 
 // ---------------------------------------------------------------------------
 
@@ -2,32 +2,70 @@
 #define VAST_BATCH_HPP
 
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
-#include <caf/binary_deserializer.hpp>
-#include <caf/binary_serializer.hpp>
-#include <caf/message.hpp>
-#include <caf/streambuf.hpp>
-
 #include "vast/aliases.hpp"
 #include "vast/bitmap.hpp"
 #include "vast/compression.hpp"
-#include "vast/detail/compressedbuf.hpp"
+#include "vast/data.hpp"
+#include "vast/error.hpp"
 #include "vast/expected.hpp"
+#include "vast/offset.hpp"
+#include "vast/operator.hpp"
 #include "vast/time.hpp"
 #include "vast/type.hpp"
+#include "vast/type_registry.hpp"
+#include "vast/view.hpp"
+#include "vast/detail/column.hpp"
 
 namespace vast {
 
 class event;
+class expression;
 
-/// A compressed sequence of events.
+/// A compressed sequence of events in columnar layout. A batch consists of
+/// *blocks* of consecutive events, which a reader can decode independently.
+/// A block groups its events into one *table* per event type. The table of a
+/// record type has one column per (flattened) record field, and the table of
+/// any other type a single column of values. Each table has two additional
+/// columns holding the position of each event in the batch and its
+/// timestamp. Columns have type-specific encodings (see
+/// ::detail::encode_column) and get compressed individually.
+///
+/// The serialized batch has the following layout:
+///
+///     +--------+--------+-------+------+--------+-------------+-----...---+
+///     | method | events | first | last | blocks | block table |  blocks    |
+///     +--------+--------+-------+------+--------+-------------+-----...---+
+///
+/// The header fields up to *last* are uncompressed, so the number of
+/// events and their time bounds can be read without touching the blocks.
+/// *first* and *last* are the timestamps of the earliest and latest event in
+/// *zig-zag* encoding. The block table contains the position of the first
+/// event and the size in bytes of each block. A block has the following
+/// layout:
+///
+///     +--------+-------------------------------...---+
+///     | tables |  table 0  | ... |  table N-1        |
+///     +--------+-------------------------------...---+
+///
+/// Each table consists of a section with the event type, layout, and whether
+/// the columns use a compression dictionary, then the number of columns, and
+/// finally one section per column. A section has the same
+/// format as a block of ::detail::compressedbuf, i.e., uncompressed size,
+/// compressed size, and the compressed bytes. All integers outside sections
+/// are in *variable byte* encoding.
 class batch {
   using buffer_type = std::vector<char>;
   using size_type = uint64_t;
 
 public:
+  /// Compression dictionaries per event type.
+  using dictionary_map = std::unordered_map<type, dictionary>;
+
   /// A proxy class to write events into the batch.
   class writer;
 
@@ -37,6 +75,16 @@ public:
   /// Constructs an empty batch.
   batch() = default;
 
+  /// Constructs a batch over serialized bytes without copying them, e.g.,
+  /// from a memory-mapped file.
+  /// @param bytes The serialized batch, as returned by ::bytes.
+  /// @param size The number of bytes.
+  /// @param owner An object that keeps *bytes* alive, which the batch and all
+  ///              its copies share.
+  /// @returns A batch viewing *bytes*.
+  static expected<batch> view(char const* bytes, size_t size,
+                              std::shared_ptr<void const> owner);
+
   /// Assigns event IDs to the batch.
   /// @param begin The ID of the first event in the batch.
   /// @param end The ID one past the last ID in the batch.
@@ -52,29 +100,82 @@ public:
   /// Retrieves the bitmap of IDs for this batch
   const bitmap& ids() const;
 
+  /// Retrieves the range of event IDs.
+  /// @returns The IDs of the first and last event, or ::invalid_event_id
+  ///          twice if the batch has no IDs.
+  std::pair<event_id, event_id> id_range() const;
+
   /// Retrieves the number of events in the batch.
   /// @returns The number of events in the batch.
   size_type events() const;
 
+  /// Retrieves the timestamp of the earliest event.
+  /// @returns The minimum event timestamp or `timestamp::max()` if the batch
+  ///          is empty.
+  timestamp first() const;
+
+  /// Retrieves the timestamp of the latest event.
+  /// @returns The maximum event timestamp or `timestamp::min()` if the batch
+  ///          is empty.
+  timestamp last() const;
+
+  /// Retrieves the serialized representation of the batch.
+  /// @returns A pointer to the bytes of the batch.
+  char const* bytes() const;
+
+  /// Retrieves the size of the serialized representation.
+  /// @returns The number of bytes of the batch.
+  size_t size() const;
+
   template <class Inspector>
   friend auto inspect(Inspector& f, batch& b) {
-    return f(b.data_);
+    b.own();
+    return f(b.ids_, b.data_);
   }
 
 private:
-  compression method_;
-  timestamp first_ = timestamp::max();
-  timestamp last_ = timestamp::min();
-  size_type events_ = 0;
+  // The uncompressed meta data at the beginning of a serialized batch.
+  struct header {
+    compression method = compression::null;
+    size_type events = 0;
+    timestamp first = timestamp::max();
+    timestamp last = timestamp::min();
+  };
+
+  // Parses the header at the beginning of a serialized batch.
+  static bool read_header(char const*& ptr, char const* end, header& h);
+
+  // Retrieves the header of this batch.
+  header read_header() const;
+
+  // Copies viewed bytes into the batch.
+  void own();
+
   bitmap ids_;
   buffer_type data_;
+  char const* view_ = nullptr;
+  size_t view_size_ = 0;
+  std::shared_ptr<void const> owner_;
 };
 
 class batch::writer {
 public:
+  /// The default number of events per block.
+  static constexpr size_t default_block_size = 1 << 10;
+
   /// Constructs a writer from a batch.
   /// @param method The compression method to use.
-  writer(compression method = compression::null);
+  /// @param block_size The number of events per block.
+  /// @param dictionaries Optional compression dictionaries for the columns of
+  ///                     each event type, which must outlive the writer.
+  /// @param registry An optional type registry, which must outlive the
+  ///                 writer. If present, the batch stores the registered ID
+  ///                 of each event type instead of the full type.
+  /// @pre `block_size > 0`
+  writer(compression method = compression::null,
+         size_t block_size = default_block_size,
+         dictionary_map const* dictionaries = nullptr,
+         type_registry* registry = nullptr);
 
   /// Writes an event into the batch.
   /// @param e The event to serialize.
@@ -84,40 +185,255 @@ public:
   batch seal();
 
 private:
+  // The columns of all events with the same type.
+  struct table {
+    type event_type;
+    bool columnar;
+    std::vector<vector> columns;
+  };
+
+  table& get_table(type const& t, bool columnar);
+
+  // Encodes the tables of the current block.
+  void flush();
+
   batch batch_;
-  std::unordered_map<type, uint32_t> type_cache_;
-  caf::vectorbuf vectorbuf_;
-  detail::compressedbuf compressedbuf_;
-  caf::stream_serializer<detail::compressedbuf&> serializer_;
+  header header_;
+  size_t block_size_;
+  dictionary_map const* dictionaries_;
+  type_registry* registry_;
+  std::vector<std::pair<size_type, size_type>> blocks_;
+  buffer_type block_data_;
+  std::vector<table> tables_;
+  std::unordered_map<type, size_t> record_tables_;
+  std::unordered_map<type, size_t> value_tables_;
 };
 
 class batch::reader {
 public:
+  class event_view;
+
   /// Constructs a reader from a batch.
   /// @param b The batch to extract objects from.
-  reader(batch const& b);
+  /// @param dictionaries The compression dictionaries used when writing *b*,
+  ///                     which must outlive the reader.
+  /// @param types The registered types to resolve the type IDs in *b*, if
+  ///              written with a type registry.
+  reader(batch const& b, dictionary_map const* dictionaries = nullptr,
+         type_registry::snapshot_type types = nullptr);
 
   /// Extracts all events.
   /// @returns The set events in the corresponding batch.
   expected<std::vector<event>> read();
 
-  /// Extracts events according to a bitmap.
+  /// Extracts events according to a bitmap. Decodes only the blocks that
+  /// contain the requested events.
   /// @param ids The set of event IDs encoded as bitmap.
   /// @returns The set events according to *ids*.
   expected<std::vector<event>> read(const bitmap& ids);
 
+  /// Extracts events according to a bitmap into an existing buffer. The
+  /// reader keeps its decoding buffers across calls, so that a long-lived
+  /// reader together with a reused buffer avoids most allocations besides
+  /// the ones for the event values themselves.
+  /// @param ids The set of event IDs encoded as bitmap.
+  /// @param xs The buffer to append the events according to *ids* to.
+  /// @returns An error if decoding fails, in which case *xs* may contain a
+  ///          subset of the requested events.
+  error read(const bitmap& ids, std::vector<event>& xs);
+
+  /// Visits events according to a bitmap as views instead of materializing
+  /// them. The reader decodes each block into views of its uncompressed
+  /// columns, which reference strings in place. These buffers act as an
+  /// arena for all events of the block: they keep their capacity across
+  /// blocks and reads, and get recycled at once when the reader moves on to
+  /// the next block. Hence the allocations grow with the number of columns
+  /// rather than with the number of values.
+  /// @param ids The set of event IDs encoded as bitmap.
+  /// @param f The function to invoke with each event according to *ids* in
+  ///          ascending order of IDs. The view is valid only during the call.
+  /// @returns An error if decoding fails, in which case *f* may have seen a
+  ///          subset of the requested events.
+  error each(const bitmap& ids, std::function<void(event_view const&)> f);
+
+  /// Extracts events according to a bitmap and projects them onto a subset of
+  /// their fields. For events in columnar layout, the reader decompresses and
+  /// decodes only the columns of the selected fields.
+  /// @param ids The set of event IDs encoded as bitmap.
+  /// @param fields The offsets of the fields to select from the record type
+  ///               of each event.
+  /// @returns The events according to *ids*, each having a record type that
+  ///          consists of the selected fields named by their keys. Events
+  ///          whose type lacks one of the fields are not part of the result.
+  expected<std::vector<event>> read(const bitmap& ids,
+                                    std::vector<offset> const& fields);
+
+  /// Evaluates a predicate on a field of all events without materializing
+  /// them. The evaluation operates on views of the encoded columns, which
+  /// reference strings in place and decode only the selected field.
+  /// @param field The offset of the field in the record type of each event.
+  /// @param op The relational operator.
+  /// @param rhs The RHS of the predicate.
+  /// @returns The IDs of the events whose field at *field* satisfies the
+  ///          predicate. Events whose type lacks the field never qualify.
+  expected<bitmap> evaluate(offset const& field, relational_operator op,
+                            data const& rhs);
+
+  /// The function that ::read_columns invokes for every table.
+  /// @param t The type of the events in the table.
+  /// @param columnar Whether the records of the table have one column per
+  ///                 leaf field in depth-first order, as opposed to a single
+  ///                 column of whole values.
+  /// @param ids The ID of the event in each row.
+  /// @param timestamps The timestamp of the event in each row.
+  /// @param columns The value columns, from which the function may move.
+  using column_function = std::function<
+    void(type const& t, bool columnar, std::vector<event_id> const& ids,
+         vector& timestamps, std::vector<vector>& columns)
+  >;
+
+  /// Decodes all events column by column without assembling events, e.g.,
+  /// to index them.
+  /// @param f The function to invoke for the table of each event type in
+  ///          every block.
+  /// @returns An error if decoding fails or the batch lacks event IDs.
+  error read_columns(column_function f);
+
+  /// Extracts the encoded but uncompressed columns of each event type, e.g.,
+  /// to train compression dictionaries.
+  /// @returns The encoded columns per event type.
+  expected<std::unordered_map<type, std::vector<std::vector<char>>>> columns();
+
 private:
-  expected<event> materialize();
-
-  buffer_type const& data_;
-  std::unordered_map<uint32_t, type> type_cache_;
-  select_range<bitmap_bit_range> id_range_;
-  size_type available_;
-  caf::charbuf charbuf_;
-  detail::compressedbuf compressedbuf_;
-  caf::stream_deserializer<detail::compressedbuf&> deserializer_;
+  // An entry in the block table.
+  struct block {
+    size_type first;
+    size_type events;
+    char const* data;
+    size_t size;
+  };
+
+  // Parses the batch header and the block table.
+  error parse();
+
+  // Invokes `decode(blk)` for each block with events according to a bitmap
+  // and then `f(pos, id)` for each of these events, where `pos` is the
+  // position of the event within its block.
+  template <class Decode, class F>
+  error locate(const bitmap& ids, Decode decode, F f);
+
+  // Appends the events according to a bitmap, projected onto `fields_` if
+  // set.
+  error extract(const bitmap& ids, std::vector<event>& result);
+
+  // The projection of an event type onto the selected fields.
+  struct projection {
+    type projected; // none if the type lacks a selected field
+    std::vector<std::pair<size_t, size_t>> leaves; // leaf columns per field
+    std::vector<bool> columns; // the columns to read in columnar layout
+  };
+
+  // Computes the projection of an event type onto `fields_`.
+  projection const& project(type const& t);
+
+  // The uncompressed columns of a table. Unselected columns remain empty.
+  struct table {
+    type event_type;
+    bool columnar;
+    std::vector<std::vector<char>> columns;
+    projection const* proj;
+  };
+
+  // Decodes all events of a block into `block_events_`, with the event at
+  // position `blk.first` ending up at the front.
+  error decode(block const& blk);
+
+  // A table whose columns event views reference.
+  struct view_table {
+    table raw;
+    std::vector<detail::column_view> columns;
+  };
+
+  // Decodes all tables of a block into `view_tables_` and records the table
+  // and row of each position in the block in `view_rows_`.
+  error decode_views(block const& blk);
+
+  // Reads the next table of a block.
+  error read_table(char const*& ptr, char const* end, table& t);
+
+  batch const& batch_;
+  dictionary_map const* dictionaries_;
+  type_registry::snapshot_type types_;
+  compression method_;
+  std::vector<block> blocks_;
+  std::vector<offset> const* fields_ = nullptr;
+  std::unordered_map<type, projection> projections_;
+  // Decoding buffers, which retain their capacity across blocks and reads.
+  std::vector<event> block_events_;
+  std::vector<char> table_header_;
+  table table_;
+  std::vector<vector> table_columns_;
+  std::vector<view_table> view_tables_;
+  std::vector<std::pair<size_t, size_t>> view_rows_;
 };
 
+/// A non-owning view of an event in a batch, which references the decoding
+/// buffers of a batch::reader.
+class batch::reader::event_view {
+public:
+  /// @returns The ID of the event.
+  event_id id() const;
+
+  /// @returns The timestamp of the event.
+  vast::timestamp timestamp() const;
+
+  /// @returns The type of the event.
+  type const& event_type() const;
+
+  /// Retrieves the number of values of the event. A record in columnar
+  /// layout has one value per leaf field in depth-first order, and any other
+  /// event a single value.
+  size_t size() const;
+
+  /// Accesses a value of the event.
+  /// @param i The index of the value.
+  /// @returns A view of the value at index *i*.
+  /// @pre `i < size()`
+  data_view const& operator[](size_t i) const;
+
+  /// Creates an owning copy of the event, e.g., to keep it beyond the visit.
+  /// @returns The event that this view references.
+  event materialize() const;
+
+private:
+  friend reader;
+
+  event_view(event_id id, view_table const& t, size_t row);
+
+  event_id id_;
+  view_table const* table_;
+  size_t row_;
+};
+
+/// Checks whether a batch may contain events that satisfy an expression,
+/// judging only by the time bounds in the batch header.
+/// @param b The batch to check.
+/// @param expr The normalized and validated expression.
+/// @returns `false` if no event in *b* can satisfy the time restrictions of
+///          *expr*.
+/// @relates batch time_restrictor
+bool may_match(batch const& b, expression const& expr);
+
+/// Trains a compression dictionary for each event type from the columns of
+/// existing batches.
+/// @param batches The batches to draw samples from.
+/// @param max_size The maximum size of each dictionary in bytes.
+/// @returns A dictionary for each event type with enough samples.
+/// @relates batch
+expected<batch::dictionary_map>
+train_dictionaries(std::vector<batch> const& batches,
+                   size_t max_size = dictionary::default_max_size);
+
 } // namespace vast
 
 #endif
@@ -23,6 +23,7 @@ namespace vast {
 ///      // Inspectors
 ///      bool empty() const;
 ///      size_type size() const;
+///      size_t memusage() const;
 ///
 ///      // Modifiers
 ///      void append_bit(bool bit); // optional
@@ -92,6 +92,12 @@ public:
     return coder_;
   }
 
+  /// Computes the number of heap bytes occupied by the bitmap index.
+  /// @returns The memory usage in bytes.
+  size_t memusage() const {
+    return coder_.memusage();
+  }
+
   friend bool operator==(bitmap_index const& x, bitmap_index const& y) {
     return x.coder_ == y.coder_;
   }
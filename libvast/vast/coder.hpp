@@ -55,6 +55,10 @@ struct coder {
 
   /// Retrieves the coder-specific bitmap storage.
   auto& storage() const;
+
+  /// Computes the number of heap bytes occupied by the coder.
+  /// @returns The memory usage in bytes.
+  size_t memusage() const;
 };
 
 /// A coder that wraps a single bitmap (and can thus only stores 2 values).
@@ -91,6 +95,10 @@ public:
     return bitmap_;
   }
 
+  size_t memusage() const {
+    return bitmap_.memusage();
+  }
+
   friend bool operator==(singleton_coder const& x, singleton_coder const& y) {
     return x.bitmap_ == y.bitmap_;
   }
@@ -129,6 +137,13 @@ public:
     return bitmaps_;
   }
 
+  size_t memusage() const {
+    auto result = bitmaps_.capacity() * sizeof(Bitmap);
+    for (auto& bm : bitmaps_)
+      result += bm.memusage();
+    return result;
+  }
+
   friend bool operator==(vector_coder const& x, vector_coder const& y) {
     return x.size_ == y.size_ && x.bitmaps_ == y.bitmaps_;
   }
@@ -441,6 +456,15 @@ public:
     return coders_;
   }
 
+  size_t memusage() const {
+    auto result = base_.size() * sizeof(typename base::value_type)
+                  + xs_.capacity() * sizeof(value_type)
+                  + coders_.capacity() * sizeof(coder_type);
+    for (auto& c : coders_)
+      result += c.memusage();
+    return result;
+  }
+
   friend bool operator==(multi_level_coder const& x,
                          multi_level_coder const& y) {
     return x.base_ == y.base_ && x.coders_ == y.coders_;
@@ -0,0 +1,58 @@
+#ifndef VAST_COLUMN_STATISTICS_HPP
+#define VAST_COLUMN_STATISTICS_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "vast/data.hpp"
+#include "vast/operator.hpp"
+
+namespace vast {
+
+/// Summary statistics of the values of a column, gathered while indexing a
+/// partition. The statistics consist of a uniform random sample of the
+/// values, which acts as an equi-depth histogram for any type, and a
+/// *k minimum values* sketch that estimates the number of distinct values.
+/// Both have a fixed size, independent of the number of values.
+class column_statistics {
+public:
+  /// The maximum number of sampled values.
+  static constexpr size_t sample_size = 256;
+
+  /// The number of hash values in the distinct-value sketch.
+  static constexpr size_t sketch_size = 64;
+
+  /// Adds a value to the statistics.
+  /// @param x The value to add.
+  void add(data const& x);
+
+  /// Retrieves the number of values, including nil.
+  /// @returns The number of values added.
+  uint64_t count() const;
+
+  /// Estimates the number of distinct non-nil values, which is exact for up
+  /// to ::sketch_size values.
+  /// @returns The estimated number of distinct values.
+  uint64_t distinct() const;
+
+  /// Estimates the fraction of values that satisfy a predicate.
+  /// @param op The relational operator.
+  /// @param rhs The RHS of the predicate.
+  /// @returns The estimated selectivity in *[0, 1]*.
+  double selectivity(relational_operator op, data const& rhs) const;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, column_statistics& s) {
+    return f(s.count_, s.nils_, s.sample_, s.minima_);
+  }
+
+private:
+  uint64_t count_ = 0;
+  uint64_t nils_ = 0;
+  std::vector<data> sample_;
+  std::vector<uint64_t> minima_; // sorted
+};
+
+} // namespace vast
+
+#endif
@@ -3,8 +3,11 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <memory>
+#include <vector>
 
 #include "vast/config.hpp"
+#include "vast/expected.hpp"
 
 namespace vast {
 
@@ -13,10 +16,86 @@ enum class compression : int8_t {
   null      = 0,
   lz4       = 1,
 #ifdef VAST_HAVE_SNAPPY
-  snappy    = 2
+  snappy    = 2,
 #endif
+#ifdef VAST_HAVE_ZSTD
+  zstd      = 3,
+#endif
+};
+
+/// Checks whether a compression method makes use of dictionaries.
+/// @param method The compression method.
+/// @returns `true` iff *method* compresses differently with a dictionary.
+bool supports_dictionary(compression method);
+
+/// A dictionary trained from sample inputs, which improves the compression
+/// ratio of small inputs that resemble the samples. Only Zstandard makes use
+/// of dictionaries, all other methods ignore them.
+class dictionary {
+public:
+  /// The default maximum size of a dictionary in bytes.
+  static constexpr size_t default_max_size = 64 << 10;
+
+  /// Trains a dictionary.
+  /// @param samples The sample inputs.
+  /// @param max_size The maximum size of the dictionary in bytes.
+  /// @returns The trained dictionary or an error if there were not enough
+  ///          samples or no compression method supports dictionaries.
+  static expected<dictionary>
+  train(std::vector<std::vector<char>> const& samples,
+        size_t max_size = default_max_size);
+
+  /// Constructs an empty dictionary.
+  dictionary() = default;
+
+  /// Retrieves the dictionary contents.
+  std::vector<char> const& bytes() const;
+
+  /// The dictionary in the form that a compression library operates on.
+  struct digest;
+
+  /// Retrieves the digested dictionary, which the first call computes once
+  /// instead of every compression. Copies of a dictionary share the digest.
+  /// @returns The digest of the dictionary contents.
+  digest& digested() const;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, dictionary& d) {
+    d.digest_.reset(); // Loading may change the contents.
+    return f(d.bytes_);
+  }
+
+private:
+  std::vector<char> bytes_;
+  mutable std::shared_ptr<digest> digest_;
 };
 
+/// Compresses a contiguous byte sequence.
+/// @param method The compression method.
+/// @param in The uncompressed input.
+/// @param in_size The size of *in*.
+/// @param out The buffer to write the compressed output into, which is
+///            resized to the size of the compressed output.
+/// @param level The method-specific compression level, with 0 selecting the
+///              default level of *method*.
+/// @param dict An optional dictionary to compress with.
+void compress(compression method, char const* in, size_t in_size,
+              std::vector<char>& out, int level = 0,
+              dictionary const* dict = nullptr);
+
+/// Uncompresses a contiguous byte sequence.
+/// @param method The compression method.
+/// @param in The compressed input.
+/// @param in_size The size of *in*.
+/// @param out The buffer to write the uncompressed output into.
+/// @param out_size The size of *out*, which must be large enough to hold the
+///                 uncompressed output.
+/// @param dict The dictionary used during compression, if any.
+/// @returns The size of the uncompressed output or 0 on failure.
+size_t uncompress(compression method, char const* in, size_t in_size,
+                  char* out, size_t out_size,
+                  dictionary const* dict = nullptr);
+
 /// The LZ4 compression algorithm.
 namespace lz4 {
 
@@ -53,6 +132,33 @@ bool uncompress(char const* in, size_t in_size, char* out);
 } // namespace snappy
 #endif // VAST_SNAPPY
 
+#ifdef VAST_HAVE_ZSTD
+/// The Zstandard compression algorithm.
+namespace zstd {
+
+/// The compression level when not specified otherwise.
+constexpr int default_level = 3;
+
+/// Returns an upper bound for the compressed output.
+/// @param size The size of the uncompressed input.
+size_t compress_bound(size_t size);
+
+/// Compresses a contiguous byte sequence.
+/// @param level The compression level in *[1, 22]*.
+/// @param dict An optional dictionary to compress with.
+/// @returns The size of the compressed output or 0 on failure.
+size_t compress(char const* in, size_t in_size, char* out, size_t out_size,
+                int level = default_level, dictionary const* dict = nullptr);
+
+/// Uncompresses a contiguous byte sequence.
+/// @param dict The dictionary used during compression, if any.
+/// @returns The size of the uncompressed output or 0 on failure.
+size_t uncompress(char const* in, size_t in_size, char* out, size_t out_size,
+                  dictionary const* dict = nullptr);
+
+} // namespace zstd
+#endif // VAST_HAVE_ZSTD
+
 } // namespace vast
 
 #endif
@@ -1,6 +1,8 @@
 #ifndef VAST_CONCEPT_PARSEABLE_VAST_DATA_HPP
 #define VAST_CONCEPT_PARSEABLE_VAST_DATA_HPP
 
+#include <iterator>
+
 #include "vast/data.hpp"
 
 #include "vast/concept/parseable/core/parser.hpp"
@@ -23,16 +25,16 @@ struct access::parser<data> : vast::parser<access::parser<data>> {
   static auto make() {
     auto to_vector = [](std::vector<data>&& v) { return vector{std::move(v)}; };
     auto to_set = [](std::vector<data>&& v) {
-      set s;
-      for (auto& x : v)
-        s.insert(std::move(x));
-      return s;
+      return set(std::make_move_iterator(v.begin()),
+                 std::make_move_iterator(v.end()));
     };
     auto to_table = [](std::vector<std::tuple<data, data>>&& v) -> table {
-      table t;
+      std::vector<std::pair<data, data>> xs;
+      xs.reserve(v.size());
       for (auto& x : v)
-        t.emplace(std::move(get<0>(x)), std::move(get<1>(x)));
-      return t;
+        xs.emplace_back(std::move(get<0>(x)), std::move(get<1>(x)));
+      return table(std::make_move_iterator(xs.begin()),
+                   std::make_move_iterator(xs.end()));
     };
     static auto ws = ignore(*parsers::space);
     rule<Iterator, data> p;
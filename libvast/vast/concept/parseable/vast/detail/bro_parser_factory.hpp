@@ -1,6 +1,8 @@
 #ifndef VAST_CONCEPT_PARSEABLE_VAST_DETAIL_BRO_PARSER_FACTORY_HPP
 #define VAST_CONCEPT_PARSEABLE_VAST_DETAIL_BRO_PARSER_FACTORY_HPP
 
+#include <iterator>
+
 #include "vast/data.hpp"
 #include "vast/type.hpp"
 #include "vast/concept/parseable/core.hpp"
@@ -168,10 +170,8 @@ struct bro_parser_factory {
 
   result_type operator()(set_type const& t) const {
     auto set_insert = [](std::vector<Attribute> v) {
-      set s;
-      for (auto& x : v)
-        s.insert(std::move(x));
-      return s;
+      return set(std::make_move_iterator(v.begin()),
+                 std::make_move_iterator(v.end()));
     };
     return (visit(*this, t.value_type) % set_separator_) ->* set_insert;
   }
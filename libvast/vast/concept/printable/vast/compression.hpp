@@ -21,6 +21,10 @@ struct compression_printer : printer<compression_printer> {
 #ifdef VAST_HAVE_SNAPPY
       case compression::snappy:
         return str.print(out, "snappy");
+#endif
+#ifdef VAST_HAVE_ZSTD
+      case compression::zstd:
+        return str.print(out, "zstd");
 #endif
     }
   }
@@ -0,0 +1,54 @@
+#ifndef VAST_CONCEPT_PRINTABLE_VAST_VIEW_HPP
+#define VAST_CONCEPT_PRINTABLE_VAST_VIEW_HPP
+
+#include "vast/view.hpp"
+#include "vast/concept/printable/vast/data.hpp"
+
+namespace vast {
+
+struct data_view_printer : printer<data_view_printer> {
+  using attribute = data_view;
+
+  template <typename Iterator>
+  struct visitor {
+    visitor(Iterator& out) : out_{out} {
+    }
+
+    template <typename T>
+    bool operator()(T const& x) const {
+      return make_printer<T>{}.print(out_, x);
+    }
+
+    bool operator()(string_view str) const {
+      auto escaped = printers::str ->* [](string_view x) {
+        return detail::byte_escape(to_string(x), "\"");
+      };
+      auto p = '"' << escaped << '"';
+      return p.print(out_, str);
+    }
+
+    bool operator()(data const* x) const {
+      return data_printer{}.print(out_, *x);
+    }
+
+    Iterator& out_;
+  };
+
+  template <typename Iterator>
+  bool print(Iterator& out, data_view const& x) const {
+    return visit(visitor<Iterator>{out}, x);
+  }
+};
+
+template <>
+struct printer_registry<data_view> {
+  using type = data_view_printer;
+};
+
+namespace printers {
+  auto const data_view = data_view_printer{};
+} // namespace printers
+
+} // namespace vast
+
+#endif
@@ -1,13 +1,19 @@
 #ifndef VAST_DETAIL_CACHE
 #define VAST_DETAIL_CACHE
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <caf/deserializer.hpp>
 #include <caf/serializer.hpp>
 
+#include "vast/optional.hpp"
 #include "vast/detail/assert.hpp"
 #include "vast/detail/iterator.hpp"
 
@@ -29,11 +35,14 @@ struct cache_policy
   /// Inserts a key.
   iterator insert(T key);
 
-  /// Erases a key.
-  size_t erase(T key);
+  /// Erases the key pointed to by an iterator in constant time.
+  void erase(iterator i);
 
   /// Evicts the next element and returns it.
-  T evict() const;
+  T evict();
+
+  /// Removes all keys.
+  void clear();
 
   // For range semantics.
   const_iterator begin() const;
@@ -49,12 +58,8 @@ public:
   using iterator = typename tracker::iterator;
   using const_iterator = typename tracker::const_iterator;
 
-  size_t erase(T const& key) {
-    auto i = std::find(tracker_.begin(), tracker_.end(), key);
-    if (i == tracker_.end())
-      return 0;
+  void erase(iterator i) {
     tracker_.erase(i);
-    return 1;
   }
 
   T evict() {
@@ -64,6 +69,10 @@ public:
     return victim;
   }
 
+  void clear() {
+    tracker_.clear();
+  }
+
   const_iterator begin() const {
     return tracker_.begin();
   }
@@ -108,26 +117,154 @@ public:
   }
 };
 
-/// A direct-mapped cache with fixed capacity.
+/// A *segmented LRU* (SLRU) cache eviction policy, which resists scans. New
+/// keys enter a probationary segment and move into a protected segment only
+/// when accessed again. Eviction picks the least recently used probationary
+/// key first, so that a scan over keys accessed only once merely displaces
+/// other probationary keys. The protected segment holds at most 80% of all
+/// keys. When it outgrows this share, its least recently used key falls back
+/// into the probationary segment.
+template <typename T>
+class slru {
+  struct node {
+    T key;
+    bool hot;
+  };
+
+  // The probationary keys precede the protected keys, both in LRU order.
+  using tracker = std::list<node>;
+
+public:
+  using iterator = typename tracker::iterator;
+
+  class const_iterator
+    : public iterator_adaptor<
+        const_iterator,
+        typename tracker::const_iterator,
+        T,
+        std::bidirectional_iterator_tag,
+        T const&
+      > {
+    using super = iterator_adaptor<
+      const_iterator,
+      typename tracker::const_iterator,
+      T,
+      std::bidirectional_iterator_tag,
+      T const&
+    >;
+
+  public:
+    using super::super;
+
+  private:
+    friend iterator_access;
+
+    T const& dereference() const {
+      return this->base()->key;
+    }
+  };
+
+  slru() : boundary_{tracker_.end()} {
+  }
+
+  slru(slru const&) = delete;
+  slru& operator=(slru const&) = delete;
+
+  void access(iterator i) {
+    if (i->hot) {
+      if (i == boundary_ && std::next(i) != tracker_.end())
+        ++boundary_;
+    } else {
+      i->hot = true;
+      ++protected_;
+      if (boundary_ == tracker_.end())
+        boundary_ = i;
+    }
+    tracker_.splice(tracker_.end(), tracker_, i);
+    while (protected_ * 5 > tracker_.size() * 4) {
+      boundary_->hot = false;
+      ++boundary_;
+      --protected_;
+    }
+  }
+
+  iterator insert(T key) {
+    return tracker_.insert(boundary_, node{std::move(key), false});
+  }
+
+  void erase(iterator i) {
+    if (i->hot)
+      --protected_;
+    if (i == boundary_)
+      ++boundary_;
+    tracker_.erase(i);
+  }
+
+  T evict() {
+    VAST_ASSERT(!tracker_.empty());
+    auto i = tracker_.begin();
+    T victim{std::move(i->key)};
+    erase(i);
+    return victim;
+  }
+
+  void clear() {
+    tracker_.clear();
+    boundary_ = tracker_.end();
+    protected_ = 0;
+  }
+
+  const_iterator begin() const {
+    return const_iterator{tracker_.begin()};
+  }
+
+  const_iterator end() const {
+    return const_iterator{tracker_.end()};
+  }
+
+private:
+  tracker tracker_;
+  iterator boundary_; // The first protected key.
+  size_t protected_ = 0;
+};
+
+/// A weight function that counts every value as one unit, which makes the
+/// capacity of a cache a number of elements.
+struct unit_weight {
+  template <typename T>
+  size_t operator()(T const&) const {
+    return 1;
+  }
+};
+
+/// A direct-mapped cache with fixed capacity. The capacity bounds the total
+/// weight of the values, e.g., their size in bytes, which the cache computes
+/// once upon insertion.
 template <
   typename Key,
   typename Value,
-  template <typename> class Policy = lru
+  template <typename> class Policy = lru,
+  typename Weight = unit_weight
 >
 class cache {
 public:
   using key_type = Key;
   using mapped_type = Value;
   using policy = Policy<key_type>;
+  using weight_function = Weight;
 
   /// The callback to invoke for evicted elements.
   using evict_callback = std::function<void(key_type const&, mapped_type&)>;
 
+  /// A value together with its bookkeeping.
+  struct entry {
+    mapped_type value;
+    typename policy::iterator position;
+    size_t weight;
+  };
+
   /// The cache cache_map holding the hot entries.
-  using cache_map = std::unordered_map<
-    key_type,
-    std::pair<mapped_type, typename policy::iterator>
-  >;
+  using cache_map = std::unordered_map<key_type, entry>;
 
   class const_iterator :
     public iterator_facade<
@@ -153,17 +290,21 @@ public:
 
     std::pair<key_type const&, mapped_type const&> dereference() const {
       auto i = cache_->cache_.find(*i_);
-      return std::make_pair(i->first, i->second.first);
+      return std::make_pair(i->first, i->second.value);
     }
 
     cache const* cache_;
     typename policy::const_iterator i_;
   };
 
-  /// Constructs an LRU cache with a maximum number of elements.
-  /// @param capacity The maximum number of elements in the cache.
+  /// Constructs a cache with a maximum total weight.
+  /// @param capacity The maximum total weight of the elements in the cache,
+  ///                 i.e., the number of elements for unit weights.
+  /// @param weight The function computing the weight of a value.
   /// @pre `capacity > 0`
-  cache(size_t capacity = 100) : capacity_{capacity} {
+  cache(size_t capacity = 100, weight_function weight = {})
+    : capacity_{capacity},
+      weight_function_(std::move(weight)) {
     VAST_ASSERT(capacity_ > 0);
   }
 
@@ -174,12 +315,13 @@ public:
   }
 
   /// Accesses the value for a given key. If key does not exists,
-  /// the function default-constructs a value of `mapped_type`.
+  /// the function default-constructs a value of `mapped_type`. The weight of
+  /// the entry remains the weight of the default-constructed value.
   /// @param key The key to lookup.
   /// @returns The value corresponding to *key*.
   mapped_type& operator[](key_type const& key) {
     auto i = find(key);
-    return i == cache_.end() ? *insert(key, {}).first : i->second.first;
+    return i == cache_.end() ? *insert(key, {}).first : i->second.value;
   }
 
   /// Retrieves a value for a given key. If the key exists in the cache, the
@@ -189,7 +331,7 @@ public:
   /// @returns An iterator for *key* or the end iterator if *key* is not hot.
   mapped_type* lookup(key_type const& key) {
     auto i = find(key);
-    return i == cache_.end() ? nullptr : &i->second.first;
+    return i == cache_.end() ? nullptr : &i->second.value;
   }
 
   /// Checks whether a given key has a cache entry *without* involving the
@@ -200,7 +342,8 @@ public:
     return cache_.find(key) != cache_.end();
   }
 
-  /// Inserts a fresh entry in the cache.
+  /// Inserts a fresh entry in the cache, evicting elements until the new one
+  /// fits. A value heavier than the capacity evicts all other elements.
   /// @param key The key mapping to *value*.
   /// @param value The value for *key*.
   /// @returns An pair of an iterator and boolean flag. If the flag is `true`,
@@ -209,12 +352,14 @@ public:
   std::pair<mapped_type*, bool> insert(key_type key, mapped_type value) {
     auto i = find(key);
     if (i != cache_.end())
-      return {&i->second.first, false};
-    if (cache_.size() == capacity_)
+      return {&i->second.value, false};
+    auto w = weight_function_(value);
+    while (!cache_.empty() && weight_ + w > capacity_)
       evict();
     auto k = policy_.insert(key);
-    auto j = cache_.emplace(std::move(key), make_pair(std::move(value), k));
-    return {&j.first->second.first, true};
+    auto j = cache_.emplace(std::move(key), entry{std::move(value), k, w});
+    weight_ += w;
+    return {&j.first->second.value, true};
   }
 
   /// Removes an entry for a given key without invoking the eviction callback.
@@ -224,27 +369,27 @@ public:
     auto i = cache_.find(key);
     if (i == cache_.end())
       return 0;
-    policy_.erase(key);
+    policy_.erase(i->second.position);
+    weight_ -= i->second.weight;
     cache_.erase(i);
     return 1;
   }
 
-  /// Retrieves the maximum number elements the cache can hold.
+  /// Retrieves the maximum total weight of the elements in the cache.
   /// @returns The cache's capacity.
   size_t capacity() const {
     return capacity_;
   }
 
   /// Adjusts the cache capacity and evicts elements if the new capacity is
-  /// smaller than the previous one.
+  /// smaller than the current weight.
   /// @param c the new capacity.
   /// @pre `c > 0`
   void capacity(size_t c) {
     VAST_ASSERT(c > 0);
-    auto victims = std::min(cache_.size(), capacity_ - c);
-    for (size_t i = 0; i < victims; ++i)
-      evict();
     capacity_ = c;
+    while (weight_ > capacity_)
+      evict();
   }
 
   /// Retrieves the current number of elements in the cache.
@@ -253,6 +398,12 @@ public:
     return cache_.size();
   }
 
+  /// Retrieves the total weight of the elements in the cache.
+  /// @returns The sum of the weights of all elements.
+  size_t weight() const {
+    return weight_;
+  }
+
   /// Checks whether the cache is empty.
   /// @returns `true` iff the cache holds no elements.
   bool empty() const {
@@ -261,8 +412,9 @@ public:
 
   /// Removes all elements from the cache.
   void clear() {
-    policy_ = {};
+    policy_.clear();
     cache_.clear();
+    weight_ = 0;
   }
 
   const_iterator begin() const {
@@ -277,7 +429,7 @@ private:
   typename cache_map::iterator find(key_type const& key) {
     auto i = cache_.find(key);
     if (i != cache_.end())
-      policy_.access(i->second.second);
+      policy_.access(i->second.position);
     return i;
   }
 
@@ -285,19 +437,139 @@ private:
     auto i = cache_.find(policy_.evict());
     VAST_ASSERT(i != cache_.end());
     if (on_evict_)
-      on_evict_(i->first, i->second.first);
+      on_evict_(i->first, i->second.value);
+    weight_ -= i->second.weight;
     cache_.erase(i);
   }
 
   policy policy_;
   size_t capacity_;
+  size_t weight_ = 0;
+  weight_function weight_function_;
   evict_callback on_evict_;
   cache_map cache_;
 };
 
-template <class Key, class Value, template <class> class Policy>
-void serialize(caf::serializer& sink, cache<Key, Value, Policy> const& c) {
-  sink << static_cast<uint32_t>(c.capacity());
+/// A thread-safe cache that partitions its keys by hash value into
+/// independently locked shards, each of which holds an equal share of the
+/// capacity. Lookups return copies of the values, because a reference would
+/// outlive the lock of its shard.
+template <
+  typename Key,
+  typename Value,
+  template <typename> class Policy = lru,
+  typename Weight = unit_weight,
+  typename Hash = std::hash<Key>
+>
+class sharded_cache {
+public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using cache_type = cache<Key, Value, Policy, Weight>;
+  using evict_callback = typename cache_type::evict_callback;
+
+  /// Constructs a sharded cache.
+  /// @param capacity The maximum total weight of all shards.
+  /// @param shards The number of shards.
+  /// @param weight The function computing the weight of a value.
+  /// @pre `shards > 0 && capacity >= shards`
+  sharded_cache(size_t capacity, size_t shards = 16, Weight weight = {}) {
+    VAST_ASSERT(shards > 0 && capacity >= shards);
+    shards_.reserve(shards);
+    for (auto i = 0u; i < shards; ++i)
+      shards_.push_back(std::make_unique<shard>(capacity / shards, weight));
+  }
+
+  /// Sets a callback for elements to be evicted. The callback executes while
+  /// holding the lock of the shard of the evicted element.
+  /// @param fun The function to invoke with the element being evicted.
+  void on_evict(evict_callback fun) {
+    for (auto& s : shards_) {
+      std::lock_guard<std::mutex> lock{s->mutex};
+      s->local.on_evict(fun);
+    }
+  }
+
+  /// Retrieves a copy of the value for a given key.
+  /// @param key The key to lookup.
+  /// @returns The value for *key* if it exists in the cache.
+  optional<mapped_type> lookup(key_type const& key) {
+    auto& s = locate(key);
+    std::lock_guard<std::mutex> lock{s.mutex};
+    if (auto x = s.local.lookup(key))
+      return *x;
+    return {};
+  }
+
+  /// Inserts a fresh entry in the cache.
+  /// @param key The key mapping to *value*.
+  /// @param value The value for *key*.
+  /// @returns `true` if *key* did not exist in the cache.
+  bool insert(key_type key, mapped_type value) {
+    auto& s = locate(key);
+    std::lock_guard<std::mutex> lock{s.mutex};
+    return s.local.insert(std::move(key), std::move(value)).second;
+  }
+
+  /// Removes an entry for a given key without invoking the eviction callback.
+  /// @param key The key to remove.
+  /// @returns The number of entries removed.
+  size_t erase(key_type const& key) {
+    auto& s = locate(key);
+    std::lock_guard<std::mutex> lock{s.mutex};
+    return s.local.erase(key);
+  }
+
+  /// Retrieves the current number of elements in all shards.
+  /// @returns The number of elements in the cache.
+  size_t size() const {
+    return accumulate([](cache_type const& c) { return c.size(); });
+  }
+
+  /// Retrieves the total weight of the elements in all shards.
+  /// @returns The sum of the weights of all elements.
+  size_t weight() const {
+    return accumulate([](cache_type const& c) { return c.weight(); });
+  }
+
+  /// Removes all elements from the cache.
+  void clear() {
+    for (auto& s : shards_) {
+      std::lock_guard<std::mutex> lock{s->mutex};
+      s->local.clear();
+    }
+  }
+
+private:
+  struct shard {
+    shard(size_t capacity, Weight weight) : local{capacity, std::move(weight)} {
+    }
+
+    std::mutex mutex;
+    cache_type local;
+  };
+
+  shard& locate(key_type const& key) {
+    return *shards_[Hash{}(key) % shards_.size()];
+  }
+
+  template <class F>
+  size_t accumulate(F f) const {
+    size_t result = 0;
+    for (auto& s : shards_) {
+      std::lock_guard<std::mutex> lock{s->mutex};
+      result += f(s->local);
+    }
+    return result;
+  }
+
+  std::vector<std::unique_ptr<shard>> shards_;
+};
+
+template <class Key, class Value, template <class> class Policy, class Weight>
+void serialize(caf::serializer& sink,
+               cache<Key, Value, Policy, Weight> const& c) {
+  sink << static_cast<uint64_t>(c.capacity());
   auto size = c.size();
   sink.begin_sequence(size);
   for (auto entry : c)
@@ -305,9 +577,10 @@ void serialize(caf::serializer& sink, cache<Key, Value, Policy> const& c) {
   sink.end_sequence();
 }
 
-template <class Key, class Value, template <class> class Policy>
-void serialize(caf::deserializer& source, cache<Key, Value, Policy>& c) {
-  uint32_t capacity;
+template <class Key, class Value, template <class> class Policy, class Weight>
+void serialize(caf::deserializer& source,
+               cache<Key, Value, Policy, Weight>& c) {
+  uint64_t capacity;
   source >> capacity;
   c.capacity(capacity);
   size_t size;
@@ -0,0 +1,102 @@
+#ifndef VAST_DETAIL_COLUMN_HPP
+#define VAST_DETAIL_COLUMN_HPP
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "vast/aliases.hpp"
+#include "vast/error.hpp"
+#include "vast/expected.hpp"
+#include "vast/view.hpp"
+
+namespace vast {
+namespace detail {
+
+/// Encodes a sequence of values as a single column. A column has the
+/// following layout:
+///
+///     +--------+------+----------+----------------------...---+
+///     | values | kind | validity |  encoded values            |
+///     +--------+------+----------+----------------------...---+
+///
+/// The number of values comes in *variable byte* encoding. The kind is the
+/// variant index of the values, or the generic kind if the values have
+/// different types. The validity byte indicates whether a bit-packed mask of
+/// non-nil values follows. Only non-nil values get encoded, depending on their
+/// kind:
+///
+/// - Booleans: bit-packed.
+/// - Integers, counts, timestamps, and intervals: the difference to the
+///   previous value in *zig-zag* and *variable byte* encoding.
+/// - Reals: 8 raw bytes.
+/// - Strings: a dictionary plus variable byte indexes if the column has
+///   low cardinality, length-prefixed bytes otherwise.
+/// - Addresses: 16 raw bytes. Subnets have an additional length byte.
+/// - Ports: the number in variable byte encoding plus one byte for the type.
+/// - Everything else: the CAF serialization of the values.
+///
+/// @param xs The values of the column.
+/// @param sink The buffer to append the encoded column to.
+void encode_column(vector const& xs, std::vector<char>& sink);
+
+/// Decodes a column written with ::encode_column.
+/// @param begin The beginning of the encoded column.
+/// @param end The end of the encoded column.
+/// @param max_values The maximum number of values, e.g., the number of
+///                   events of the enclosing block, which bounds the memory
+///                   that a malformed column can claim.
+/// @returns The values of the column.
+expected<vector>
+decode_column(char const* begin, char const* end,
+              size_t max_values = std::numeric_limits<size_t>::max());
+
+/// Decodes a column written with ::encode_column into an existing vector,
+/// reusing its memory.
+/// @param begin The beginning of the encoded column.
+/// @param end The end of the encoded column.
+/// @param xs The vector that holds the values of the column afterwards.
+/// @param max_values The maximum number of values, e.g., the number of
+///                   events of the enclosing block, which bounds the memory
+///                   that a malformed column can claim.
+/// @returns An error if the column is malformed.
+error decode_column(char const* begin, char const* end, vector& xs,
+                    size_t max_values = std::numeric_limits<size_t>::max());
+
+/// A read-only view of a column written with ::encode_column. Creating the
+/// view decodes basic values inline, but strings remain in the encoded bytes.
+/// Only columns with values of different types get materialized.
+class column_view {
+public:
+  /// Creates a view of an encoded column.
+  /// @param begin The beginning of the encoded column.
+  /// @param end The end of the encoded column.
+  /// @param max_values The maximum number of values of the column.
+  /// @returns The view of the column, which must not outlive the encoded
+  ///          bytes.
+  static expected<column_view>
+  make(char const* begin, char const* end,
+       size_t max_values = std::numeric_limits<size_t>::max());
+
+  column_view() = default;
+  column_view(column_view&&) = default;
+  column_view& operator=(column_view&&) = default;
+
+  /// @returns The number of values in the column.
+  size_t size() const;
+
+  /// Accesses a value of the column.
+  /// @param i The row of the value.
+  /// @returns A view of the value in row *i*.
+  /// @pre `i < size()`
+  data_view const& operator[](size_t i) const;
+
+private:
+  std::vector<data_view> views_;
+  vector values_; // The values referenced by views of generic columns.
+};
+
+} // namespace detail
+} // namespace vast
+
+#endif
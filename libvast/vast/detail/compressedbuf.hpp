@@ -2,6 +2,8 @@
 #define VAST_DETAIL_COMPRESSEDBUF_HPP
 
 #include <cstddef>
+#include <deque>
+#include <future>
 #include <streambuf>
 #include <vector>
 
@@ -10,6 +12,8 @@
 namespace vast {
 namespace detail {
 
+class thread_pool;
+
 /// A compressed streambuffer that compresses/uncompresses into/from an
 /// underlying `std::streambuf`. It uses two buffers internally, for compressed
 /// and uncompressed data. Once a buffer has been exhausted, the streambuffer
@@ -26,6 +30,14 @@ namespace detail {
 ///     +-------------------+-----------------+--------------------...---+
 ///
 /// Both sizes are written in *variable byte* encoding to save space.
+///
+/// Given a thread pool, the streambuffer (un)compresses multiple blocks
+/// concurrently. In writing mode, it hands each filled put area to the pool
+/// and writes the compressed blocks in order as they complete. In reading
+/// mode, it fetches several blocks ahead from the underlying streambuffer and
+/// uncompresses them in the background. The format of the blocks stays the
+/// same in either case. Note that read-ahead consumes the underlying
+/// streambuffer beyond the current block.
 class compressedbuf : public std::streambuf {
 public:
   /// The default buffer size in bytes.
@@ -35,10 +47,16 @@ public:
   /// @param sb The underlying streambuffer to read from or write to.
   /// @param method The compression method to use for each block.
   /// @param block_size The size of the internal buffer for uncompressed data.
+  /// @param level The compression level, with 0 selecting the default level
+  ///              of *method*.
+  /// @param pool The thread pool to (un)compress blocks with, or `nullptr`
+  ///             to process blocks sequentially in the calling thread.
   /// @pre `block_size > 1`
   compressedbuf(std::streambuf& sb,
                 compression method = compression::null,
-                size_t block_size = default_block_size);
+                size_t block_size = default_block_size,
+                int level = 0,
+                thread_pool* pool = nullptr);
 
 protected:
   // -- buffer management and positioning ------------------------------------
@@ -62,12 +80,27 @@ protected:
   std::streamsize xsgetn(char_type* s, std::streamsize n) override;
 
 private:
-  void compress();
-  void uncompress();
+  // Compresses the put area and writes or schedules the resulting block.
+  // Returns the number of bytes written to the underlying streambuffer or -1
+  // on failure.
+  int flush_block();
+
+  // Writes pending blocks until at most *n* remain. Returns the number of
+  // bytes written or -1 on failure.
+  int drain(size_t n);
+
+  // Fetches blocks and schedules them for uncompression until the read-ahead
+  // window is full.
+  void fetch();
+
+  size_t max_pending() const;
 
   std::streambuf& streambuf_;
   compression method_;
   size_t block_size_;
+  int level_;
+  thread_pool* pool_;
+  std::deque<std::future<std::vector<char>>> pending_;
   std::vector<char> compressed_;
   std::vector<char> uncompressed_;
 };
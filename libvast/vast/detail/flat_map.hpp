@@ -0,0 +1,268 @@
+#ifndef VAST_DETAIL_FLAT_MAP_HPP
+#define VAST_DETAIL_FLAT_MAP_HPP
+
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "vast/detail/operators.hpp"
+
+namespace vast {
+namespace detail {
+
+/// A map abstraction as sorted STL vector of key-value pairs. Unlike a
+/// node-based map, the entries reside in one contiguous allocation, which
+/// makes small maps cheap to copy and iterate. Insertions invalidate
+/// iterators. Since modifying a key through an iterator would break the
+/// order of the entries, all iterators are constant. The mapped values remain
+/// mutable through ::at and `operator[]`.
+template <
+  class Key,
+  class T,
+  class Compare = std::less<Key>,
+  class Allocator = std::allocator<std::pair<Key, T>>
+>
+class flat_map : totally_ordered<flat_map<Key, T, Compare, Allocator>> {
+  friend bool operator<(flat_map const& x, flat_map const& y) {
+    return x.v_ < y.v_;
+  }
+
+  friend bool operator==(flat_map const& x, flat_map const& y) {
+    return x.v_ == y.v_;
+  }
+
+public:
+  // -- types ------------------------------------------------------------------
+
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using vector_type = std::vector<value_type, Allocator>;
+  using allocator_type = typename vector_type::allocator_type;
+  using size_type = typename vector_type::size_type;
+  using difference_type = typename vector_type::difference_type;
+  using reference = typename vector_type::reference;
+  using const_reference = typename vector_type::const_reference;
+  using pointer = typename vector_type::pointer;
+  using const_pointer = typename vector_type::const_pointer;
+  using iterator = typename vector_type::const_iterator;
+  using const_iterator = typename vector_type::const_iterator;
+  using reverse_iterator = typename vector_type::const_reverse_iterator;
+  using const_reverse_iterator = typename vector_type::const_reverse_iterator;
+  using key_compare = Compare;
+
+  // -- construction -----------------------------------------------------------
+
+  flat_map() = default;
+
+  flat_map(std::initializer_list<value_type> l) {
+    insert(l.begin(), l.end());
+  }
+
+  template <class InputIterator>
+  flat_map(InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  // -- element access and lookup ----------------------------------------------
+
+  T& at(Key const& key) {
+    auto i = position(key);
+    if (i == v_.end() || key_compare{}(key, i->first))
+      throw std::out_of_range{"vast::detail::flat_map::at"};
+    return i->second;
+  }
+
+  T const& at(Key const& key) const {
+    auto i = find(key);
+    if (i == end())
+      throw std::out_of_range{"vast::detail::flat_map::at"};
+    return i->second;
+  }
+
+  T& operator[](Key const& key) {
+    auto i = position(key);
+    if (i == v_.end() || key_compare{}(key, i->first))
+      i = v_.emplace(i, std::piecewise_construct, std::forward_as_tuple(key),
+                     std::forward_as_tuple());
+    return i->second;
+  }
+
+  iterator find(Key const& key) {
+    auto i = lower_bound(key);
+    return i == end() || key_compare{}(key, i->first) ? end() : i;
+  }
+
+  const_iterator find(Key const& key) const {
+    auto i = lower_bound(key);
+    return i == end() || key_compare{}(key, i->first) ? end() : i;
+  }
+
+  size_type count(Key const& key) const {
+    return find(key) != end() ? 1 : 0;
+  }
+
+  iterator lower_bound(Key const& key) {
+    return std::lower_bound(begin(), end(), key, compare_key{});
+  }
+
+  const_iterator lower_bound(Key const& key) const {
+    return std::lower_bound(begin(), end(), key, compare_key{});
+  }
+
+  vector_type const& as_vector() const {
+    return v_;
+  }
+
+  // -- iterators --------------------------------------------------------------
+
+  iterator begin() {
+    return v_.begin();
+  }
+
+  const_iterator begin() const {
+    return v_.begin();
+  }
+
+  iterator end() {
+    return v_.end();
+  }
+
+  const_iterator end() const {
+    return v_.end();
+  }
+
+  reverse_iterator rbegin() {
+    return v_.rbegin();
+  }
+
+  const_reverse_iterator rbegin() const {
+    return v_.rbegin();
+  }
+
+  reverse_iterator rend() {
+    return v_.rend();
+  }
+
+  const_reverse_iterator rend() const {
+    return v_.rend();
+  }
+
+  // -- capacity ---------------------------------------------------------------
+
+  bool empty() const {
+    return v_.empty();
+  }
+
+  size_type size() const {
+    return v_.size();
+  }
+
+  void reserve(size_type capacity) {
+    v_.reserve(capacity);
+  }
+
+  void shrink_to_fit() {
+    v_.shrink_to_fit();
+  }
+
+  // -- modifiers --------------------------------------------------------------
+
+  void clear() {
+    v_.clear();
+  }
+
+  std::pair<iterator, bool> insert(value_type x) {
+    auto i = lower_bound(x.first);
+    if (i == end() || key_compare{}(x.first, i->first))
+      return {v_.insert(i, std::move(x)), true};
+    return {i, false};
+  }
+
+  /// Inserts a range of entries in *O((n + m) log (n + m))* time by
+  /// appending, sorting, and removing duplicates, rather than shifting the
+  /// vector for each entry. Of entries with equivalent keys, the one already
+  /// in the map or else the first in the range remains.
+  template <class InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    auto n = v_.size();
+    v_.insert(v_.end(), first, last);
+    auto middle = v_.begin() + n;
+    std::stable_sort(middle, v_.end(), compare_entries{});
+    std::inplace_merge(v_.begin(), middle, v_.end(), compare_entries{});
+    auto equivalent = [](value_type const& x, value_type const& y) {
+      return !key_compare{}(x.first, y.first);
+    };
+    v_.erase(std::unique(v_.begin(), v_.end(), equivalent), v_.end());
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(Key const& key, Args&&... args) {
+    auto i = lower_bound(key);
+    if (i != end() && !key_compare{}(key, i->first))
+      return {i, false};
+    i = v_.emplace(i, std::piecewise_construct, std::forward_as_tuple(key),
+                   std::forward_as_tuple(std::forward<Args>(args)...));
+    return {i, true};
+  }
+
+  iterator erase(const_iterator i) {
+    return v_.erase(i);
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    return v_.erase(first, last);
+  }
+
+  size_type erase(Key const& key) {
+    auto i = find(key);
+    if (i == end())
+      return 0;
+    v_.erase(i);
+    return 1;
+  }
+
+  void swap(flat_map& other) {
+    v_.swap(other.v_);
+  }
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, flat_map& m) {
+    return f(m.v_);
+  }
+
+private:
+  struct compare_key {
+    bool operator()(value_type const& x, Key const& key) const {
+      return key_compare{}(x.first, key);
+    }
+  };
+
+  struct compare_entries {
+    bool operator()(value_type const& x, value_type const& y) const {
+      return key_compare{}(x.first, y.first);
+    }
+  };
+
+  // Locates the first entry not less than a key for modification.
+  typename vector_type::iterator position(Key const& key) {
+    return std::lower_bound(v_.begin(), v_.end(), key, compare_key{});
+  }
+
+  vector_type v_;
+};
+
+} // namespace detail
+} // namespace vast
+
+#endif
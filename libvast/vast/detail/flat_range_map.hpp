@@ -0,0 +1,167 @@
+#ifndef VAST_DETAIL_FLAT_RANGE_MAP_HPP
+#define VAST_DETAIL_FLAT_RANGE_MAP_HPP
+
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "vast/detail/assert.hpp"
+#include "vast/detail/range_map.hpp"
+
+namespace vast {
+namespace detail {
+
+/// A read-optimized variant of ::range_map that maps half-open, *disjoint*
+/// intervals to values. The map stores the left endpoints, right endpoints,
+/// and values in three sorted arrays. A lookup performs a branchless binary
+/// search over the left endpoints only, which touches a single contiguous
+/// array instead of chasing pointers through tree nodes. Injecting intervals
+/// in ascending order, as with monotonically increasing event IDs, appends
+/// to the arrays in amortized constant time.
+template <typename Point, typename Value>
+class flat_range_map {
+  static_assert(std::is_arithmetic<Point>::value,
+                "Point must be an arithmetic type");
+
+public:
+  flat_range_map() = default;
+
+  /// Freezes a range map into its flat representation.
+  /// @param xs The range map to copy.
+  explicit flat_range_map(range_map<Point, Value> const& xs) {
+    lefts_.reserve(xs.size());
+    rights_.reserve(xs.size());
+    values_.reserve(xs.size());
+    for (auto x : xs) {
+      lefts_.push_back(std::get<0>(x));
+      rights_.push_back(std::get<1>(x));
+      values_.push_back(std::get<2>(x));
+    }
+  }
+
+  /// Inserts a value for a right-open range, merging it with adjacent
+  /// intervals that have the same value.
+  /// @param l The left endpoint of the interval.
+  /// @param r The right endpoint of the interval.
+  /// @param v The value associated with *[l,r)*.
+  /// @returns `true` on success and `false` if *[l,r)* overlaps with an
+  ///          existing interval.
+  bool inject(Point l, Point r, Value v) {
+    VAST_ASSERT(l < r);
+    // Appending is the common case, which we handle without a search.
+    auto i = lefts_.empty() || l >= rights_.back()
+      ? lefts_.size()
+      : static_cast<size_t>(
+          std::upper_bound(lefts_.begin(), lefts_.end(), l) - lefts_.begin());
+    if ((i > 0 && rights_[i - 1] > l) || (i < lefts_.size() && lefts_[i] < r))
+      return false;
+    auto left_merge = i > 0 && rights_[i - 1] == l && values_[i - 1] == v;
+    auto right_merge = i < lefts_.size() && lefts_[i] == r && values_[i] == v;
+    if (left_merge && right_merge) {
+      rights_[i - 1] = rights_[i];
+      erase_at(i);
+    } else if (left_merge) {
+      rights_[i - 1] = r;
+    } else if (right_merge) {
+      lefts_[i] = l;
+    } else {
+      lefts_.insert(lefts_.begin() + i, l);
+      rights_.insert(rights_.begin() + i, r);
+      values_.insert(values_.begin() + i, std::move(v));
+    }
+    return true;
+  }
+
+  /// Removes the interval containing a point.
+  /// @param p A point from a range that maps to a value.
+  /// @returns `true` if *p* mapped to a value that has been removed.
+  bool erase(Point p) {
+    auto i = locate(p);
+    if (i == lefts_.size())
+      return false;
+    erase_at(i);
+    return true;
+  }
+
+  /// Retrieves the value for a given point.
+  /// @param p The point to lookup.
+  /// @returns A pointer to the value associated with the half-open interval
+  ///          *[a,b)* if *a <= p < b* and `nullptr` otherwise.
+  Value const* lookup(Point const& p) const {
+    auto i = locate(p);
+    return i != lefts_.size() ? &values_[i] : nullptr;
+  }
+
+  /// Retrieves value and interval for a given point.
+  /// @param p The point to lookup.
+  /// @returns A tuple with the last component holding a pointer to the value
+  ///          associated with the half-open interval *[a,b)* if *a <= p < b*,
+  ///          and `nullptr` otherwise. If the last component points to a
+  ///          valid value, then the first two represent *[a,b)* and *[0,0)*
+  ///          otherwise.
+  std::tuple<Point, Point, Value const*> find(Point const& p) const {
+    using tuple_type = std::tuple<Point, Point, Value const*>;
+    auto i = locate(p);
+    if (i == lefts_.size())
+      return tuple_type{0, 0, nullptr};
+    return tuple_type{lefts_[i], rights_[i], &values_[i]};
+  }
+
+  /// Retrieves the size of the range map.
+  /// @returns The number of intervals in the map.
+  size_t size() const {
+    return lefts_.size();
+  }
+
+  /// Checks whether the range map is empty.
+  /// @returns `true` iff the map is empty.
+  bool empty() const {
+    return lefts_.empty();
+  }
+
+  /// Clears the range map.
+  void clear() {
+    lefts_.clear();
+    rights_.clear();
+    values_.clear();
+  }
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, flat_range_map& m) {
+    return f(m.lefts_, m.rights_, m.values_);
+  }
+
+private:
+  // Finds the index of the interval containing a point, or size() if none
+  // exists. The loop compiles to conditional moves, so that the search has
+  // no branch mispredictions and a fixed number of iterations.
+  size_t locate(Point const& p) const {
+    auto n = lefts_.size();
+    if (n == 0)
+      return 0;
+    auto base = lefts_.data();
+    while (n > 1) {
+      auto half = n / 2;
+      base = base[half] <= p ? base + half : base;
+      n -= half;
+    }
+    auto i = static_cast<size_t>(base - lefts_.data());
+    return *base <= p && p < rights_[i] ? i : lefts_.size();
+  }
+
+  void erase_at(size_t i) {
+    lefts_.erase(lefts_.begin() + i);
+    rights_.erase(rights_.begin() + i);
+    values_.erase(values_.begin() + i);
+  }
+
+  std::vector<Point> lefts_;
+  std::vector<Point> rights_;
+  std::vector<Value> values_;
+};
+
+} // namespace detail
+} // namespace vast
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef VAST_DETAIL_FLAT_SET_HPP
 #define VAST_DETAIL_FLAT_SET_HPP
 
+#include <algorithm>
+#include <initializer_list>
 #include <vector>
 
 #include "vast/detail/operators.hpp"
@@ -51,8 +53,7 @@ public:
   flat_set() = default;
 
   flat_set(std::initializer_list<T> l) {
-    for (auto& x : l)
-      insert(x);
+    insert(l.begin(), l.end());
   }
 
   template <typename InputIterator>
@@ -202,13 +203,21 @@ public:
       return {i, false};
   };
 
+  /// Inserts a range of elements in *O((n + m) log (n + m))* time by
+  /// appending, sorting, and removing duplicates, rather than shifting the
+  /// vector for each element.
+  /// @returns `true` iff all elements were new.
   template <typename InputIterator>
   bool insert(InputIterator first, InputIterator last) {
-    bool all = true;
-    while (first != last)
-      if (!insert(*first++).second)
-        all = false;
-    return all;
+    auto n = v_.size();
+    v_.insert(v_.end(), first, last);
+    auto added = v_.size() - n;
+    auto middle = v_.begin() + n;
+    std::stable_sort(middle, v_.end(), compare{});
+    std::inplace_merge(v_.begin(), middle, v_.end(), compare{});
+    auto equivalent = [](T const& x, T const& y) { return !compare{}(x, y); };
+    v_.erase(std::unique(v_.begin(), v_.end(), equivalent), v_.end());
+    return v_.size() == n + added;
   }
 
   template <typename... Args>
@@ -225,7 +234,7 @@ public:
   }
 
   size_type erase(T const& x) {
-    auto i = std::find(v_.begin(), v_.end(), x);
+    auto i = find(x);
     if (i == v_.end())
       return 0;
 
@@ -246,7 +255,7 @@ public:
   }
 
   void swap(flat_set& other) {
-    v_.swap(other);
+    v_.swap(other.v_);
   }
 
   //
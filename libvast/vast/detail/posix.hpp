@@ -1,6 +1,7 @@
 #ifndef VAST_DETAIL_POSIX_HPP
 #define VAST_DETAIL_POSIX_HPP
 
+#include <cstdint>
 #include <string>
 
 /// Various POSIX-compliant helper tools.
@@ -109,6 +110,15 @@ bool close(int fd);
 /// @returns `true` on successful reading.
 bool read(int fd, void* buffer, size_t bytes, size_t* got = nullptr);
 
+/// Wraps `pread(2)` to read a given number of bytes at an offset, without
+/// changing the file position.
+/// @param fd The file descriptor to read from.
+/// @param buffer The buffer to write into.
+/// @param bytes The number of bytes to read from *fd*.
+/// @param offset The position in the file where to start reading.
+/// @returns `true` iff *bytes* bytes were read.
+bool pread(int fd, void* buffer, size_t bytes, uint64_t offset);
+
 /// Wraps `write(2)`.
 /// @param fd The file descriptor to write to.
 /// @param buffer The buffer to read from.
@@ -123,6 +133,43 @@ bool write(int fd, void const* buffer, size_t bytes, size_t* put = nullptr);
 /// @returns `true` on successful seek.
 bool seek(int fd, size_t bytes);
 
+/// Retrieves the size of a file via `fstat(2)`.
+/// @param fd The file descriptor of a regular file.
+/// @param size Receives the file size in bytes.
+/// @returns `true` on success.
+bool file_size(int fd, size_t& size);
+
+/// Wraps `ftruncate(2)`.
+/// @param fd The file descriptor of a regular file opened for writing.
+/// @param size The new size of the file in bytes.
+/// @returns `true` on success.
+bool truncate(int fd, uint64_t size);
+
+/// Wraps `fsync(2)`.
+/// @param fd The file descriptor of a file opened for writing.
+/// @returns `true` on success.
+bool fsync(int fd);
+
+/// Wraps `mmap(2)` to map a file read-only into memory.
+/// @param fd The file descriptor to map.
+/// @param size The number of bytes to map.
+/// @returns The address of the mapping or `nullptr` on failure.
+/// @pre `size > 0`
+void* map(int fd, size_t size);
+
+/// Wraps `munmap(2)`.
+/// @param addr The address of a mapping created with ::map.
+/// @param size The size of the mapping.
+/// @returns `true` on success.
+bool unmap(void* addr, size_t size);
+
+/// Wraps `madvise(2)`.
+/// @param addr The page-aligned start of the memory region.
+/// @param size The size of the memory region.
+/// @param advice The advice to give, e.g., `MADV_SEQUENTIAL`.
+/// @returns `true` on success.
+bool advise(void* addr, size_t size, int advice);
+
 } // namespace detail
 } // namespace vast
 
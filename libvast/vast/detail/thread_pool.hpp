@@ -0,0 +1,62 @@
+#ifndef VAST_DETAIL_THREAD_POOL_HPP
+#define VAST_DETAIL_THREAD_POOL_HPP
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "vast/detail/queue.hpp"
+
+namespace vast {
+namespace detail {
+
+/// A fixed number of threads that execute tasks in FIFO order.
+class thread_pool {
+  thread_pool(thread_pool const&) = delete;
+  thread_pool& operator=(thread_pool const&) = delete;
+
+public:
+  /// Spawns the threads of the pool.
+  /// @param size The number of threads, with 0 meaning one thread per
+  ///             hardware thread.
+  explicit thread_pool(size_t size = 0);
+
+  /// Executes all pending tasks and joins the threads.
+  ~thread_pool();
+
+  /// Retrieves the number of threads.
+  size_t size() const;
+
+  /// Checks whether the calling thread belongs to the pool. A task must not
+  /// block on the result of another task of the same pool, because all
+  /// threads may end up waiting.
+  /// @returns `true` iff the caller runs on a thread of the pool.
+  bool owns_current_thread() const;
+
+  /// Schedules a function for execution.
+  /// @param f The function to execute.
+  /// @returns A future for the result of *f*.
+  template <class F>
+  auto submit(F f) -> std::future<decltype(f())> {
+    using result_type = decltype(f());
+    auto task = std::make_shared<std::packaged_task<result_type()>>(
+      std::move(f));
+    auto result = task->get_future();
+    tasks_.push([task] { (*task)(); });
+    return result;
+  }
+
+private:
+  void run();
+
+  // An empty function signals a thread to exit.
+  queue<std::function<void()>> tasks_;
+  std::vector<std::thread> threads_;
+};
+
+} // namespace detail
+} // namespace vast
+
+#endif
@@ -91,6 +91,26 @@ decode(T& x, void const* source) {
   return i;
 }
 
+/// Decodes a variable byte sequence from a buffer of untrusted input.
+/// @tparam An integral type.
+/// @param x The result of the decoding.
+/// @param ptr The beginning of the input, which advances past the decoded
+///            bytes on success.
+/// @param end The end of the input.
+/// @returns `true` iff the input starts with a complete sequence that fits
+///          into *T*.
+template <class T>
+std::enable_if_t<std::is_integral<T>{} && std::is_unsigned<T>{}, bool>
+decode(T& x, char const*& ptr, char const* end) {
+  auto i = ptr;
+  while (i != end && (static_cast<uint8_t>(*i) & 0x80))
+    ++i;
+  if (i == end || static_cast<size_t>(i - ptr) >= max_size<T>())
+    return false;
+  ptr += decode(x, ptr);
+  return true;
+}
+
 } // namespace varbyte
 } // namespace detail
 } // namespace vast
@@ -0,0 +1,42 @@
+#ifndef VAST_DETAIL_ZIGZAG_HPP
+#define VAST_DETAIL_ZIGZAG_HPP
+
+#include <type_traits>
+
+namespace vast {
+namespace detail {
+
+/// The *zig-zag* coding of signed integers into unsigned integers, which maps
+/// values with small magnitude to small numbers: 0, -1, 1, -2, 2, ... become
+/// 0, 1, 2, 3, 4, ... This makes signed values amenable to *variable byte*
+/// coding.
+namespace zigzag {
+
+/// Encodes a signed integer.
+/// @param x The value to encode.
+/// @returns The zig-zag encoded value of *x*.
+template <class T>
+std::enable_if_t<std::is_integral<T>{} && std::is_signed<T>{},
+                 std::make_unsigned_t<T>>
+encode(T x) {
+  using unsigned_type = std::make_unsigned_t<T>;
+  constexpr auto shift = sizeof(T) * 8 - 1;
+  return (static_cast<unsigned_type>(x) << 1)
+         ^ static_cast<unsigned_type>(x >> shift);
+}
+
+/// Decodes a zig-zag encoded integer.
+/// @param x The value to decode.
+/// @returns The signed value represented by *x*.
+template <class T>
+std::enable_if_t<std::is_integral<T>{} && std::is_unsigned<T>{},
+                 std::make_signed_t<T>>
+decode(T x) {
+  return static_cast<std::make_signed_t<T>>((x >> 1) ^ (~(x & 1) + 1));
+}
+
+} // namespace zigzag
+} // namespace detail
+} // namespace vast
+
+#endif
@@ -38,6 +38,11 @@ public:
 
   block_vector const& blocks() const;
 
+  /// Computes the number of heap bytes occupied by the bitmap, including
+  /// the unused capacity of its internal buffers.
+  /// @returns The memory usage in bytes.
+  size_t memusage() const;
+
   // -- modifiers ------------------------------------------------------------
 
   void append_bit(bool bit);
@@ -1,8 +1,11 @@
 #ifndef VAST_EXPRESSION_VISITORS_HPP
 #define VAST_EXPRESSION_VISITORS_HPP
 
+#include <functional>
 #include <vector>
 
+#include "vast/bitmap.hpp"
+#include "vast/expected.hpp"
 #include "vast/expression.hpp"
 #include "vast/maybe.hpp"
 #include "vast/none.hpp"
@@ -11,6 +14,7 @@
 
 namespace vast {
 
+class column_statistics;
 class event;
 
 /// Hoists the contained expression of a single-element conjunction or
@@ -64,9 +68,9 @@ struct validator {
 };
 
 /// Checks whether an expression is valid for a given time interval. The
-/// visitor returns `false` if a time extractor restricts all predicates to lay
-/// outside the given interval, and returns `true` if at least one unrestricted
-/// predicate exists in the expression.
+/// visitor returns `false` if time extractors restrict the expression such
+/// that no timestamp in the closed interval *[first, last]* can satisfy it,
+/// and `true` otherwise.
 ///
 /// @pre Requires prior expression normalization and validation.
 struct time_restrictor {
@@ -146,49 +150,66 @@ struct event_evaluator {
   relational_operator op_;
 };
 
-// FIXME
-/// Base class for expression evaluators operating on bitstreams.
-/// @tparam Derived The CRTP client.
-/// @tparam Bitstream The type of bitstream used during evaluation.
-//template <typename Derived, typename Bitstream>
-//struct bitstream_evaluator {
-//  Bitstream operator()(none) const {
-//    return {};
-//  }
-//
-//  Bitstream operator()(conjunction const& con) const {
-//    auto hits = visit(*this, con[0]);
-//    if (hits.empty() || hits.all_zeros())
-//      return {};
-//    for (size_t i = 1; i < con.size(); ++i) {
-//      hits &= visit(*this, con[i]);
-//      if (hits.empty() || hits.all_zeros()) // short-circuit
-//        return {};
-//    }
-//    return hits;
-//  }
-//
-//  Bitstream operator()(disjunction const& dis) const {
-//    Bitstream hits;
-//    for (auto& op : dis) {
-//      hits |= visit(*this, op);
-//      if (!hits.empty() && hits.all_ones()) // short-circuit
-//        break;
-//    }
-//    return hits;
-//  }
-//
-//  Bitstream operator()(negation const& n) const {
-//    auto hits = visit(*this, n.expression());
-//    hits.flip();
-//    return hits;
-//  }
-//
-//  Bitstream operator()(predicate const& pred) const {
-//    auto* bs = static_cast<Derived const*>(this)->lookup(pred);
-//    return bs ? *bs : Bitstream{};
-//  }
-//};
+/// Estimates the fraction of events that satisfy an expression, assuming
+/// that the predicates are independent.
+struct selectivity_estimator {
+  /// Retrieves the statistics for the LHS of a predicate, or `nullptr` if
+  /// none exist.
+  using statistics_function
+    = std::function<column_statistics const*(predicate const&)>;
+
+  selectivity_estimator(statistics_function f);
+
+  double operator()(none) const;
+  double operator()(conjunction const& c) const;
+  double operator()(disjunction const& d) const;
+  double operator()(negation const& n) const;
+  double operator()(predicate const& p) const;
+
+  statistics_function statistics_;
+};
+
+/// Orders the operands of all conjunctions by increasing selectivity, so
+/// that evaluation starts with the operand that yields the fewest hits. It
+/// also orders the operands of disjunctions by decreasing selectivity, so
+/// that the evaluation can stop early once all events match.
+///
+/// @pre Requires prior expression normalization.
+struct query_planner {
+  query_planner(selectivity_estimator::statistics_function f);
+
+  expression operator()(none) const;
+  expression operator()(conjunction const& c) const;
+  expression operator()(disjunction const& d) const;
+  expression operator()(negation const& n) const;
+  expression operator()(predicate const& p) const;
+
+  selectivity_estimator estimator_;
+};
+
+/// Evaluates an expression to the bitmap of matching events. Each operand of
+/// a conjunction receives the hits of its preceding operands as restriction
+/// and the evaluation stops as soon as no hits remain, which makes a prior
+/// ::query_planner pass effective.
+///
+/// @pre Requires prior expression normalization.
+struct bitmap_evaluator {
+  /// Looks up the hits for a predicate. The restriction, if present, contains
+  /// all events that can still match, and a lookup may skip the others.
+  using lookup_function
+    = std::function<expected<bitmap>(predicate const&, bitmap const*)>;
+
+  bitmap_evaluator(lookup_function f, bitmap const* restriction = nullptr);
+
+  expected<bitmap> operator()(none) const;
+  expected<bitmap> operator()(conjunction const& c) const;
+  expected<bitmap> operator()(disjunction const& d) const;
+  expected<bitmap> operator()(negation const& n) const;
+  expected<bitmap> operator()(predicate const& p) const;
+
+  lookup_function lookup_;
+  bitmap const* restriction_;
+};
 
 } // namespace vast
 
@@ -209,6 +209,19 @@ public:
   /// @returns `true` on success.
   bool read(void* sink, size_t size, size_t* got = nullptr);
 
+  /// Reads a given number of bytes at an offset without changing the file
+  /// position.
+  /// @param sink The destination of the read.
+  /// @param size The number of bytes to read.
+  /// @param offset The position in the file where to start reading.
+  /// @returns `true` iff *size* bytes were read.
+  bool read_at(void* sink, size_t size, uint64_t offset);
+
+  /// Retrieves the size of the file.
+  /// @param size Receives the file size in bytes.
+  /// @returns `true` on success.
+  bool size(size_t& size) const;
+
   /// Writes a given number of bytes into a buffer.
   /// @param source The source of the write.
   /// @param size The number of bytes to write.
@@ -216,6 +229,15 @@ public:
   /// @returns `true` on success.
   bool write(void const* source, size_t size, size_t* put = nullptr);
 
+  /// Truncates or extends the file to a given size.
+  /// @param size The new size of the file in bytes.
+  /// @returns `true` on success.
+  bool truncate(uint64_t size);
+
+  /// Writes the contents of the file through to the storage device.
+  /// @returns `true` on success.
+  bool sync();
+
   /// Seeks the file forward.
   /// @param bytes The number of bytes to seek forward relative to the current
   ///              position.
@@ -238,6 +260,65 @@ private:
   vast::path path_;
 };
 
+/// A read-only memory mapping of an entire file. The page cache backs the
+/// mapped bytes, so that readers can operate on the file contents without
+/// copying them into process memory.
+class mapped_file {
+  mapped_file(mapped_file const&) = delete;
+  mapped_file& operator=(mapped_file const&) = delete;
+
+public:
+  /// The expected access pattern, which steers the read-ahead of the kernel.
+  enum access_pattern {
+    normal,
+    sequential,
+    random,
+  };
+
+  /// Default-constructs an unmapped file.
+  mapped_file() = default;
+
+  mapped_file(mapped_file&& other);
+
+  /// Unmaps the file.
+  ~mapped_file();
+
+  mapped_file& operator=(mapped_file&& other);
+
+  /// Maps a file into memory.
+  /// @param p The path of the file to map.
+  /// @param pattern The expected access pattern.
+  /// @returns No error on success.
+  maybe<void> open(vast::path const& p, access_pattern pattern = normal);
+
+  /// Unmaps the file.
+  /// @returns `true` on success.
+  bool close();
+
+  /// Checks whether the file is mapped.
+  /// @returns `true` iff the file is mapped.
+  bool is_open() const;
+
+  /// Adjusts the expected access pattern, e.g., when switching from a full
+  /// scan to point lookups.
+  /// @param pattern The new access pattern.
+  /// @returns `true` on success.
+  bool advise(access_pattern pattern);
+
+  /// Retrieves the mapped bytes.
+  /// @returns A pointer to the beginning of the file contents.
+  char const* data() const;
+
+  /// Retrieves the size of the mapping.
+  /// @returns The file size in bytes.
+  size_t size() const;
+
+private:
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  bool is_open_ = false;
+};
+
 /// An ordered sequence of all the directory entries in a particular directory.
 class directory {
 public:
@@ -0,0 +1,106 @@
+#ifndef VAST_PARTITION_CACHE_HPP
+#define VAST_PARTITION_CACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "vast/bitmap.hpp"
+#include "vast/expected.hpp"
+#include "vast/expression.hpp"
+#include "vast/filesystem.hpp"
+#include "vast/partition_indexer.hpp"
+#include "vast/uuid.hpp"
+#include "vast/detail/cache.hpp"
+
+namespace vast {
+namespace detail {
+
+class thread_pool;
+
+} // namespace detail
+
+/// Keeps the indexes of passive partitions in memory. The cache loads a
+/// partition on first access and bounds both the number of partitions and
+/// the total number of bytes of their value indexes. Because a sealed
+/// partition materializes its columns lazily, its footprint grows with the
+/// lookups it answers. Hence the cache measures the footprint of a partition
+/// after loading it and after every lookup, and then evicts the least
+/// recently used partitions without outstanding queries until the others
+/// fit into the budget.
+class partition_cache {
+public:
+  /// Constructs a partition cache.
+  /// @param pool The threads for the partition indexers.
+  /// @param dir The directory holding one subdirectory per partition.
+  /// @param capacity The maximum number of partitions.
+  /// @param max_bytes The maximum number of bytes of all partitions, or 0 for
+  ///                  no limit.
+  /// @pre `capacity > 0`
+  partition_cache(detail::thread_pool& pool, path dir, size_t capacity,
+                  uint64_t max_bytes = 0);
+
+  partition_cache(partition_cache const&) = delete;
+  partition_cache& operator=(partition_cache const&) = delete;
+
+  /// Retrieves a partition, loading it from disk if necessary.
+  /// @param id The ID of the partition.
+  /// @returns The indexer of the partition *id*, which remains valid until
+  ///          the next call to a non-const member function.
+  expected<partition_indexer*> get(uuid const& id);
+
+  /// Looks up a predicate in a partition.
+  /// @param id The ID of the partition.
+  /// @param p The predicate to look up.
+  /// @returns The IDs of the events satisfying *p* in partition *id*.
+  expected<bitmap> lookup(uuid const& id, predicate const& p);
+
+  /// Protects a partition from eviction while a query evaluates it. Pins
+  /// nest, i.e., every call requires a matching call to ::unpin.
+  /// @param id The ID of a cached partition.
+  /// @returns `false` if *id* is not cached.
+  bool pin(uuid const& id);
+
+  /// Releases a pin and evicts partitions if the cache exceeds its budget.
+  /// @param id The ID of a pinned partition.
+  void unpin(uuid const& id);
+
+  /// Removes a partition from the cache.
+  /// @param id The ID of the partition to remove.
+  /// @returns The number of removed partitions.
+  size_t erase(uuid const& id);
+
+  /// Retrieves the number of cached partitions.
+  size_t size() const;
+
+  /// Retrieves the number of bytes of all cached partitions, as measured
+  /// after their last load or lookup.
+  uint64_t memusage() const;
+
+private:
+  struct entry {
+    std::unique_ptr<partition_indexer> indexer;
+    detail::lru<uuid>::iterator position;
+    uint64_t bytes = 0;
+    size_t pins = 0;
+  };
+
+  // Updates the footprint of a partition.
+  void measure(entry& e);
+
+  // Evicts unpinned partitions in LRU order, sparing *keep*, until the cache
+  // fits into its budget or has no more candidates.
+  void shrink(uuid const& keep);
+
+  detail::thread_pool& pool_;
+  path dir_;
+  size_t capacity_;
+  uint64_t max_bytes_;
+  uint64_t bytes_ = 0;
+  detail::lru<uuid> policy_;
+  std::unordered_map<uuid, entry> partitions_;
+};
+
+} // namespace vast
+
+#endif
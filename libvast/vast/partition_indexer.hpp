@@ -0,0 +1,201 @@
+#ifndef VAST_PARTITION_INDEXER_HPP
+#define VAST_PARTITION_INDEXER_HPP
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "vast/aliases.hpp"
+#include "vast/batch.hpp"
+#include "vast/bitmap.hpp"
+#include "vast/column_statistics.hpp"
+#include "vast/event.hpp"
+#include "vast/expected.hpp"
+#include "vast/expression.hpp"
+#include "vast/filesystem.hpp"
+#include "vast/maybe.hpp"
+#include "vast/offset.hpp"
+#include "vast/type.hpp"
+#include "vast/value_index.hpp"
+
+namespace vast {
+namespace detail {
+
+class thread_pool;
+
+} // namespace detail
+
+/// Indexes the events of a partition column by column. Adding events first
+/// splits them into one column per event type and record field, plus the
+/// columns of event names and timestamps. A columnar batch already provides
+/// these columns, so that adding it requires no event objects. Thereafter,
+/// each column with new values becomes a separate task on a thread pool that
+/// appends the whole column to its value index at once. Since no two tasks
+/// share a value index, the columns get indexed in parallel without
+/// synchronization.
+///
+/// A persistent indexer never rewrites its value indexes while the partition
+/// is active. Instead, a flush appends the column values indexed since the
+/// previous flush to a log file and then atomically replaces a small
+/// manifest holding the number of valid bytes in the log. Loading rebuilds
+/// the value indexes by replaying the log up to that size. Sealing writes
+/// all value indexes into a single file and removes the log.
+///
+/// The sealed file ends with a header that lists the columns and the byte
+/// offsets of their value indexes. Loading a sealed partition maps the file
+/// and reads only the header. A value index gets deserialized on the first
+/// access to its column, so that a query pays only for the columns it
+/// references.
+///
+/// Each column also gathers ::column_statistics of its values, which the
+/// sealed file preserves and a log replay rebuilds. Expression lookups hand
+/// them to the ::query_planner, so that a conjunction evaluates its most
+/// selective operand first and restricts the remaining operands to its hits.
+class partition_indexer {
+public:
+  /// Constructs a partition indexer.
+  /// @param pool The threads that index the columns, which must outlive the
+  ///             indexer.
+  /// @param dir The directory for the persistent state, or the empty path for
+  ///            an indexer that lives in memory only.
+  explicit partition_indexer(detail::thread_pool& pool, path dir = {});
+
+  partition_indexer(partition_indexer const&) = delete;
+  partition_indexer& operator=(partition_indexer const&) = delete;
+
+  /// Indexes the events of a batch, taking the values from its columns.
+  /// @param b The batch to index, which must have event IDs beyond the ones
+  ///          of all previously indexed events.
+  /// @returns No error on success. Invalid IDs leave the index unchanged.
+  maybe<void> add(batch const& b);
+
+  /// Indexes a sequence of events.
+  /// @param events The events to index in ascending order of their IDs,
+  ///               which must exceed the ones of all previously indexed
+  ///               events.
+  /// @returns No error on success. Invalid IDs leave the index unchanged.
+  /// @note Events with an invalid ID do not enter the index.
+  maybe<void> add(std::vector<event> const& events);
+
+  /// Loads the persistent state, i.e., the header of the sealed value indexes
+  /// followed by the values in the log.
+  /// @returns No error on success.
+  /// @pre The indexer has not indexed any events yet.
+  maybe<void> load();
+
+  /// Appends the values indexed since the last flush to the log.
+  /// @returns No error on success.
+  maybe<void> flush();
+
+  /// Writes all value indexes into a single file and removes the log, e.g.,
+  /// when the partition receives no more events.
+  /// @returns No error on success.
+  maybe<void> seal();
+
+  /// Looks up the events satisfying a predicate. The predicate must have an
+  /// ::attribute_extractor for `type` or `time`, or a ::data_extractor, on
+  /// the left-hand side and ::data on the right-hand side.
+  /// @param p The predicate to look up.
+  /// @param restriction The events that can still match, or `nullptr` for
+  ///                    all events. The result contains no other events.
+  /// @returns The IDs of the events satisfying *p*.
+  /// @note The lookup loads the value index of the column on first access,
+  ///       unless the restriction rules out all hits.
+  expected<bitmap> lookup(predicate const& p,
+                          bitmap const* restriction = nullptr);
+
+  /// Looks up the events satisfying an expression. The lookup plans the
+  /// evaluation order of the expression according to the column statistics
+  /// and then evaluates one predicate after another, each restricted to the
+  /// hits of the preceding operands of its conjunction.
+  /// @param expr The normalized expression to look up.
+  /// @returns The IDs of the events satisfying *expr*.
+  expected<bitmap> lookup(expression const& expr);
+
+  /// Retrieves the statistics of the column that a predicate refers to.
+  /// @param p The predicate with an extractor on the left-hand side.
+  /// @returns The statistics of the column of *p*, or `nullptr` if the
+  ///          partition has no such column.
+  column_statistics const* statistics(predicate const& p);
+
+  /// Retrieves the number of indexed columns, including the meta columns.
+  size_t columns() const;
+
+  /// Retrieves the number of columns whose value index resides in memory.
+  size_t resident_columns() const;
+
+  /// Computes the number of heap bytes occupied by all resident value indexes.
+  size_t memusage() const;
+
+private:
+  struct column {
+    vast::type type;
+    std::unique_ptr<value_index> index;   // Null until loaded from the file.
+    uint64_t offset = 0;                  // The position in the sealed file.
+    uint64_t size = 0;                    // The size in the sealed file.
+    std::vector<data> values;             // Staged values for the next append.
+    std::vector<event_id> ids;            // Staged IDs for the next append.
+    column_statistics statistics;         // Summary of all indexed values.
+    std::vector<data> unflushed_values;   // Indexed values not yet in the log.
+    std::vector<event_id> unflushed_ids;  // Indexed IDs not yet in the log.
+  };
+
+  using column_map = std::map<data_extractor, column>;
+
+  // An indexed field of an event type.
+  struct field {
+    vast::offset offset;
+    size_t leaf;  // The position of the field in a columnar batch table.
+    column* col;
+  };
+
+  // The indexed fields of an event type.
+  using layout_type = std::vector<field>;
+
+  // Retrieves the layout of an event type, creating its columns if
+  // necessary. The layout omits fields without a value index.
+  layout_type const& layout(type const& t);
+
+  // Retrieves the column of a field, creating it if necessary. Returns
+  // nullptr for fields without a value index.
+  column* make_column(data_extractor const& key);
+
+  // Retrieves the column that a predicate refers to. Returns nullptr if the
+  // partition has no events of the extracted type.
+  expected<column*> find(predicate const& p);
+
+  // Retrieves a column by its position in the log: the name column, the time
+  // column, and then the data columns in order of creation.
+  column* at(size_t i);
+
+  // Loads the value index of a column from the sealed file, unless it
+  // already resides in memory.
+  maybe<void> materialize(column& c) const;
+
+  // Checks that the first event ID to add exceeds all indexed IDs. Because
+  // the name column receives every event, its offset bounds all others.
+  maybe<void> check_first(event_id first);
+
+  // Appends the staged values of each column to its value index in parallel.
+  maybe<void> index(std::vector<column*> const& staged);
+
+  // Replays the log up to the size in the manifest.
+  maybe<void> replay();
+
+  detail::thread_pool& pool_;
+  path dir_;
+  column name_;
+  column time_;
+  column_map data_;
+  std::vector<column_map::iterator> order_;
+  std::unordered_map<type, layout_type> layouts_;
+  size_t flushed_columns_ = 0; // The number of data columns in the log.
+  uint64_t log_size_ = 0;      // The number of valid bytes in the log.
+  mapped_file sealed_;
+};
+
+} // namespace vast
+
+#endif
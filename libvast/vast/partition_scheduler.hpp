@@ -0,0 +1,110 @@
+#ifndef VAST_PARTITION_SCHEDULER_HPP
+#define VAST_PARTITION_SCHEDULER_HPP
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "vast/optional.hpp"
+#include "vast/time.hpp"
+#include "vast/uuid.hpp"
+
+namespace vast {
+
+/// Decides which partition to evaluate next for which query. At most a fixed
+/// number of evaluations run concurrently, e.g., one per core. Queries with a
+/// higher priority always go first. Queries of equal priority share the
+/// evaluation slots fairly: the scheduler picks the query that received the
+/// fewest evaluations so far, and a newly arriving query starts at the level
+/// of the least served query, so that it cannot starve the others.
+///
+/// Each query visits its partitions in the order of their latest event,
+/// either oldest or newest first. The latter suits interactive queries,
+/// which are typically interested in recent data.
+///
+/// All operations run in *O(log n)* time for *n* queries, except for adding
+/// a query, which sorts its partitions.
+class partition_scheduler {
+public:
+  /// The order in which a query visits its partitions.
+  enum class order {
+    oldest_first,
+    newest_first
+  };
+
+  /// A partition that a query needs to evaluate.
+  struct candidate {
+    uuid id;          ///< The partition ID.
+    timestamp latest; ///< The timestamp of the latest event in the partition.
+  };
+
+  /// The evaluation of a partition for a query.
+  struct task {
+    uuid query;
+    uuid partition;
+  };
+
+  /// Constructs a scheduler.
+  /// @param capacity The maximum number of concurrent evaluations.
+  /// @pre `capacity > 0`
+  explicit partition_scheduler(size_t capacity);
+
+  /// Adds a query.
+  /// @param query The ID of the query.
+  /// @param priority The priority of the query, with higher values first.
+  /// @param o The order in which to visit the partitions.
+  /// @param partitions The partitions to evaluate.
+  /// @returns `false` if *query* already exists.
+  bool add(uuid const& query, int priority, order o,
+           std::vector<candidate> partitions);
+
+  /// Starts the next evaluation if a slot is available.
+  /// @returns The task to run, or nothing if all slots are busy or no query
+  ///          has pending partitions.
+  optional<task> next();
+
+  /// Marks a task as completed, which frees its slot.
+  /// @param t The task returned by ::next.
+  /// @returns `true` iff the query of *t* has no more pending or running
+  ///          evaluations.
+  bool complete(task const& t);
+
+  /// Removes all pending evaluations of a query. Running evaluations still
+  /// need to be completed.
+  /// @param query The query to cancel.
+  /// @returns The number of removed evaluations.
+  size_t cancel(uuid const& query);
+
+  /// Retrieves the maximum number of concurrent evaluations.
+  size_t capacity() const;
+
+  /// Retrieves the number of running evaluations.
+  size_t running() const;
+
+  /// Retrieves the number of pending evaluations.
+  size_t pending() const;
+
+private:
+  // Orders ready queries by descending priority, ascending number of
+  // evaluations, and ascending arrival.
+  using ready_key = std::tuple<int64_t, uint64_t, uint64_t>;
+
+  struct query_state {
+    std::vector<uuid> partitions; // Pending partitions, the next one last.
+    size_t running = 0;
+    ready_key key;
+  };
+
+  size_t capacity_;
+  size_t running_ = 0;
+  size_t pending_ = 0;
+  uint64_t arrivals_ = 0;
+  std::unordered_map<uuid, query_state> queries_;
+  std::map<ready_key, uuid> ready_;
+};
+
+} // namespace vast
+
+#endif
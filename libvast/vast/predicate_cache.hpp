@@ -0,0 +1,96 @@
+#ifndef VAST_PREDICATE_CACHE_HPP
+#define VAST_PREDICATE_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vast/bitmap.hpp"
+#include "vast/expected.hpp"
+#include "vast/expression.hpp"
+#include "vast/uuid.hpp"
+#include "vast/detail/cache.hpp"
+
+namespace vast {
+
+/// Caches the hits of predicates per partition. Since only sealed partitions
+/// never change, the cache only holds results of sealed partitions. A byte
+/// budget bounds the memory of the cached bitmaps, and the least recently
+/// used results get evicted first.
+class predicate_cache {
+public:
+  /// Constructs a predicate cache.
+  /// @param capacity The maximum number of bytes of all cached bitmaps.
+  /// @pre `capacity > 0`
+  explicit predicate_cache(size_t capacity);
+
+  predicate_cache(predicate_cache const&) = delete;
+  predicate_cache& operator=(predicate_cache const&) = delete;
+
+  /// Retrieves the hits of a predicate, either from the cache or by
+  /// computing them.
+  /// @param partition The partition to evaluate *p* on.
+  /// @param p The normalized predicate.
+  /// @param sealed Whether *partition* is sealed. The cache neither serves
+  ///               nor stores results of active partitions.
+  /// @param compute The function computing the hits on a cache miss, which
+  ///                returns `expected<bitmap>`.
+  /// @returns The hits of *p* in *partition*.
+  template <class F>
+  expected<bitmap> get(uuid const& partition, predicate const& p, bool sealed,
+                       F compute) {
+    if (!sealed)
+      return compute();
+    auto k = make_key(partition, p);
+    if (auto x = cache_.lookup(k)) {
+      ++hits_;
+      return *x;
+    }
+    ++misses_;
+    auto x = compute();
+    if (x)
+      insert(partition, std::move(k), *x);
+    return x;
+  }
+
+  /// Removes all cached results of a partition.
+  /// @param partition The partition to remove.
+  /// @returns The number of removed results.
+  size_t erase(uuid const& partition);
+
+  /// Retrieves the number of lookups answered from the cache.
+  uint64_t hits() const;
+
+  /// Retrieves the number of lookups of sealed partitions that missed.
+  uint64_t misses() const;
+
+  /// Retrieves the number of cached results.
+  size_t size() const;
+
+  /// Retrieves the number of bytes of all cached bitmaps.
+  size_t bytes() const;
+
+private:
+  struct bitmap_size {
+    size_t operator()(bitmap const& bm) const {
+      return bm.memusage();
+    }
+  };
+
+  using cache_type = detail::cache<std::string, bitmap, detail::lru,
+                                   bitmap_size>;
+
+  static std::string make_key(uuid const& partition, predicate const& p);
+
+  void insert(uuid const& partition, std::string key, bitmap hits);
+
+  cache_type cache_;
+  std::unordered_map<uuid, std::vector<std::string>> keys_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+} // namespace vast
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef VAST_SEGMENT_HPP
+#define VAST_SEGMENT_HPP
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "vast/aliases.hpp"
+#include "vast/batch.hpp"
+#include "vast/expected.hpp"
+#include "vast/filesystem.hpp"
+#include "vast/maybe.hpp"
+
+namespace vast {
+namespace detail {
+
+class thread_pool;
+
+} // namespace detail
+
+/// A file holding a sequence of batches, followed by an index of the batches
+/// and a fixed-size footer:
+///
+///     +-------...---+-------...---+-------...---+--------+-------+
+///     | entry 0     | entry 1     | index       | offset | magic |
+///     +-------...---+-------...---+-------...---+--------+-------+
+///
+/// Each entry has the following layout:
+///
+///     +----------+-----------+------------+-------------------...---+
+///     | IDs size |    IDs    | batch size |  batch                  |
+///     +----------+-----------+------------+-------------------...---+
+///
+/// The IDs are the serialized bitmap of event IDs of the batch and both sizes
+/// are in *variable byte* encoding. The index has one record per entry with
+/// the first and last event ID of the batch, the position of the entry in the
+/// file, and the size of the entry. The footer holds the position of the
+/// index and a magic number. All index and footer fields are 64-bit unsigned
+/// integers in network byte order. Files without footer, as written by
+/// earlier versions, consist of entries only.
+///
+/// Reading a segment maps the file into memory and constructs batches that
+/// refer directly to the mapped bytes. Thus, repeated reads of the same
+/// segment hit the page cache instead of copying the file contents into
+/// process memory. For point lookups, a segment::reader reads only the index
+/// and then the entries of the requested events.
+class segment {
+public:
+  class reader;
+
+  /// Writes a sequence of batches into a segment file and syncs it to disk.
+  /// @param filename The path of the segment file.
+  /// @param batches The batches to write.
+  /// @returns No error once the segment file is durable.
+  static maybe<void> write(path const& filename,
+                           std::vector<batch> const& batches);
+
+  /// Maps a segment file into memory.
+  /// @param filename The path of the segment file.
+  /// @param pattern The expected access pattern, i.e., `sequential` when
+  ///                reading all batches and `random` for point lookups.
+  /// @returns The segment with batches referencing the mapped file.
+  static expected<segment> map(path const& filename,
+                               mapped_file::access_pattern pattern
+                                 = mapped_file::sequential);
+
+  /// Retrieves the batches of the segment, which keep the mapping alive.
+  /// @returns The batches of the segment.
+  std::vector<batch> const& batches() const;
+
+  /// Adjusts the expected access pattern of the mapped file.
+  /// @param pattern The new access pattern.
+  /// @returns `true` on success.
+  bool advise(mapped_file::access_pattern pattern);
+
+private:
+  std::shared_ptr<mapped_file> file_;
+  std::vector<batch> batches_;
+};
+
+/// Reads individual batches from a segment file via positional reads.
+class segment::reader {
+public:
+  /// A record in the index of a segment.
+  struct entry {
+    event_id first; ///< The first event ID in the batch.
+    event_id last;  ///< The last event ID in the batch.
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  /// Constructs a reader for a segment file.
+  /// @param filename The path of the segment file.
+  explicit reader(path filename);
+
+  /// Opens the segment file and reads its index. For files without index,
+  /// this reads the entire file once to reconstruct it.
+  /// @returns No error on success.
+  maybe<void> open();
+
+  /// Retrieves the index of the segment, ordered by event ID.
+  /// @returns The index of the segment.
+  /// @pre `open()` succeeded.
+  std::vector<entry> const& index() const;
+
+  /// Reads the batch containing an event.
+  /// @param id The event ID to look for.
+  /// @returns The batch containing *id*.
+  /// @pre `open()` succeeded.
+  expected<batch> read(event_id id);
+
+  /// Reads the batches that contain a set of events.
+  /// @param ids The event IDs to look for.
+  /// @returns The batches containing at least one event in *ids*, in the order
+  ///          of their event IDs.
+  /// @pre `open()` succeeded.
+  expected<std::vector<batch>> read(bitmap const& ids);
+
+  /// A function that consumes the events of one batch. Returning an error
+  /// aborts the lookup.
+  using consumer = std::function<error(std::vector<event>&)>;
+
+  /// Looks up a set of events. The lookup reads and filters the relevant
+  /// batches on a thread pool with at most *window* batches in flight, and
+  /// hands the matching events of each batch to a consumer, in the order of
+  /// their event IDs. Each batch filters only the IDs within its own range.
+  /// When called from a thread of *pool*, the lookup extracts the batches
+  /// sequentially on the calling thread, because waiting for tasks of the
+  /// same pool could deadlock.
+  /// @param ids The event IDs to look for.
+  /// @param pool The thread pool that reads and decodes the batches.
+  /// @param f The consumer for the events of each batch.
+  /// @param window The maximum number of batches in flight.
+  /// @returns The first error of a read or of *f*.
+  /// @pre `open()` succeeded.
+  error lookup(bitmap const& ids, detail::thread_pool& pool, consumer f,
+               size_t window = 4);
+
+private:
+  // Locates the index entry whose ID range includes an event.
+  std::vector<entry>::const_iterator find(event_id id) const;
+
+  // Collects the index entries of the batches that contain a set of events.
+  std::vector<entry> entries(bitmap const& ids) const;
+
+  // Reads and parses the entry of a batch.
+  expected<batch> read(entry const& e);
+
+  file file_;
+  std::vector<entry> index_;
+};
+
+} // namespace vast
+
+#endif
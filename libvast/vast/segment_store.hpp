@@ -0,0 +1,153 @@
+#ifndef VAST_SEGMENT_STORE_HPP
+#define VAST_SEGMENT_STORE_HPP
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "vast/aliases.hpp"
+#include "vast/batch.hpp"
+#include "vast/expected.hpp"
+#include "vast/filesystem.hpp"
+#include "vast/maybe.hpp"
+#include "vast/segment.hpp"
+#include "vast/time.hpp"
+#include "vast/uuid.hpp"
+#include "vast/detail/cache.hpp"
+#include "vast/detail/flat_range_map.hpp"
+#include "vast/detail/thread_pool.hpp"
+
+namespace vast {
+
+/// A directory of segment files that maps event IDs to the segment holding
+/// them. The store accumulates batches in memory until they reach the maximum
+/// segment size and then writes them as one segment. Each segment covers a
+/// range of event IDs that does not overlap with the range of any other
+/// segment.
+///
+/// Writing a segment happens on a dedicated I/O thread. While the thread
+/// writes one buffer of batches, new batches go into a second buffer, and
+/// lookups consider both. If the next buffer fills up before the previous
+/// write completes, the store waits for it, which bounds the memory usage at
+/// two segments.
+///
+/// The store keeps meta data about all segments in a log file named `meta`.
+/// Each record is the serialized set of removed and added segments, prefixed
+/// with its size as 32-bit unsigned integer in network byte order. Writing a
+/// segment appends a single record. Compaction and retention replace the log
+/// with one record of all segments via rename. A truncated record at the end
+/// of the log, e.g., after a crash, does not take effect, and opening the
+/// store cuts it off before the next append.
+///
+/// Lookups keep the readers of recently accessed segment files open in an LRU
+/// cache, so that repeated lookups in the same segments neither reopen the
+/// files nor parse their indexes again. Compaction and retention evict the
+/// readers of the segments they remove.
+class segment_store {
+public:
+  /// Meta data about a segment file.
+  struct segment_info {
+    uuid id;          ///< The name of the segment file.
+    event_id first;   ///< The first event ID in the segment.
+    event_id last;    ///< The last event ID in the segment.
+    timestamp latest; ///< The timestamp of the latest event.
+    uint64_t bytes;   ///< The size of the segment file.
+
+    template <class Inspector>
+    friend auto inspect(Inspector& f, segment_info& x) {
+      return f(x.id, x.first, x.last, x.latest, x.bytes);
+    }
+  };
+
+  /// Constructs a segment store.
+  /// @param dir The directory of the segment files.
+  /// @param max_segment_size The maximum size of a segment in bytes.
+  /// @param max_readers The maximum number of segment files that lookups keep
+  ///                    open.
+  /// @pre `max_segment_size > 0 && max_readers > 0`
+  segment_store(path dir, uint64_t max_segment_size, size_t max_readers = 16);
+
+  segment_store(segment_store const&) = delete;
+  segment_store& operator=(segment_store const&) = delete;
+
+  /// Loads the meta data of an existing store.
+  /// @returns No error on success.
+  maybe<void> open();
+
+  /// Adds a batch to the segment under construction and flushes the segment
+  /// if the batch would exceed the maximum segment size.
+  /// @param b The batch to add, which must have event IDs.
+  /// @returns No error on success, or the error of a previous flush. In the
+  ///          latter case, the store still buffers *b*.
+  maybe<void> put(batch b);
+
+  /// Hands the segment under construction to the I/O thread, waiting only if
+  /// the previous segment is still being written.
+  /// @returns No error on success, or the error of a previous flush.
+  maybe<void> flush();
+
+  /// Waits until the I/O thread has written all flushed segments.
+  /// @returns No error on success, or the error of a previous flush.
+  maybe<void> sync();
+
+  /// Retrieves the batches containing a set of events, from both the segment
+  /// under construction and the segment files.
+  /// @param ids The event IDs to look for.
+  /// @returns The batches containing at least one event in *ids*.
+  expected<std::vector<batch>> get(bitmap const& ids);
+
+  /// Merges runs of adjacent segments into segments of at most the maximum
+  /// segment size. Only the meta data update of a run is visible to readers,
+  /// after which the store removes the merged segment files. Compaction runs
+  /// synchronously on the calling thread, after waiting for the I/O thread to
+  /// complete a pending write.
+  /// @returns The number of segment files removed.
+  expected<size_t> compact();
+
+  /// Removes all segments whose latest event precedes a retention horizon.
+  /// This consults only the meta data, not the segment contents, and runs
+  /// synchronously on the calling thread, after waiting for the I/O thread to
+  /// complete a pending write. The store does not know about any index, so
+  /// dropping the index partitions of the expired events is up to the caller.
+  /// @param horizon The timestamp before which to drop data.
+  /// @returns The meta data of the removed segments, e.g., to drop the
+  ///          corresponding event IDs from an index.
+  expected<std::vector<segment_info>> expire(timestamp horizon);
+
+  /// Retrieves the meta data of all written segments, ordered by event ID.
+  /// The result includes segments that the I/O thread has completed until
+  /// the last call to a non-const member function.
+  /// @returns The segments of the store.
+  std::vector<segment_info> const& segments() const;
+
+  /// Retrieves the number of segment files that lookups keep open.
+  size_t open_segments() const;
+
+private:
+  // Writes a set of batches as a new segment file.
+  expected<segment_info> write(std::vector<batch> const& batches);
+
+  // Takes over the result of the I/O thread, if available or if *wait* is
+  // true. On failure, the batches of the failed write become part of the
+  // segment under construction again.
+  maybe<void> collect(bool wait);
+
+  // Atomically replaces the segment meta data, in memory and on disk.
+  maybe<void> commit(std::vector<segment_info> segments);
+
+  path dir_;
+  uint64_t max_segment_size_;
+  std::vector<segment_info> segments_;
+  detail::cache<uuid, std::unique_ptr<segment::reader>> readers_;
+  detail::flat_range_map<event_id, uuid> ranges_;
+  std::vector<batch> current_;
+  uint64_t current_size_ = 0;
+  std::shared_ptr<std::vector<batch> const> flushing_;
+  std::future<expected<segment_info>> pending_;
+  detail::thread_pool io_{1}; // Last member, so that it joins first.
+};
+
+} // namespace vast
+
+#endif
@@ -67,6 +67,12 @@ public:
   /// another.
   friend bool operator<(const type& x, const type& y);
 
+  /// Checks whether two types share the same representation. This is a cheap
+  /// sufficient (but not necessary) condition for equality.
+  friend bool identical(const type& x, const type& y) {
+    return x.ptr_ == y.ptr_;
+  }
+
   template <class Inspector>
   friend auto inspect(Inspector& f, type& t) {
     return f(*t.ptr_);
@@ -0,0 +1,64 @@
+#ifndef VAST_TYPE_REGISTRY_HPP
+#define VAST_TYPE_REGISTRY_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "vast/type.hpp"
+
+namespace caf {
+class serializer;
+class deserializer;
+} // namespace caf
+
+namespace vast {
+
+/// Assigns each distinct type a stable 32-bit ID. IDs never change once
+/// assigned, so that persistent data can refer to types by ID instead of
+/// storing the full type. The registry is thread-safe and hands out immutable
+/// snapshots for lock-free lookups.
+class type_registry {
+public:
+  /// The type ID.
+  using id_type = uint32_t;
+
+  /// An immutable sequence of types, with the position being the type ID.
+  using snapshot_type = std::shared_ptr<std::vector<type> const>;
+
+  /// Constructs an empty registry.
+  type_registry();
+
+  /// Registers a type.
+  /// @param t The type to register.
+  /// @returns The ID of *t*, which is either new or the existing ID of a type
+  ///          equal to *t*.
+  id_type add(type const& t);
+
+  /// Retrieves the type for an ID from a snapshot.
+  /// @param types The snapshot to search.
+  /// @param id The ID to lookup.
+  /// @returns The type with ID *id* or `nullptr` if no such type exists.
+  static type const* lookup(snapshot_type const& types, id_type id);
+
+  /// Retrieves the registered types.
+  /// @returns An immutable snapshot of all types registered so far.
+  snapshot_type snapshot() const;
+
+  /// Retrieves the number of registered types.
+  size_t size() const;
+
+  friend void serialize(caf::serializer& sink, type_registry const& r);
+  friend void serialize(caf::deserializer& source, type_registry& r);
+
+private:
+  mutable std::mutex mutex_;
+  snapshot_type types_;
+  std::unordered_map<type, id_type> ids_;
+};
+
+} // namespace vast
+
+#endif
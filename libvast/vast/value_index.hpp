@@ -38,6 +38,14 @@ public:
   /// @returns `true` if appending succeeded.
   bool push_back(data const& x, event_id id);
 
+  /// Appends a column of data values in one pass. Consecutive IDs enter the
+  /// internal bitmaps as runs rather than bit by bit.
+  /// @param xs The data to append to the index.
+  /// @param ids The positional identifiers of *xs* in ascending order.
+  /// @returns `true` if appending succeeded for all values.
+  /// @pre `xs.size() == ids.size()`
+  bool append(std::vector<data> const& xs, std::vector<event_id> const& ids);
+
   /// Looks up data under a relational operator.
   /// @param op The relation operator.
   /// @param x The value to lookup.
@@ -53,6 +61,11 @@ public:
   /// @returns The largest ID in the index.
   size_type offset() const;
 
+  /// Computes the number of heap bytes occupied by the value index, including
+  /// unused capacity of internal buffers.
+  /// @returns The memory usage in bytes.
+  size_t memusage() const;
+
   template <class Inspector>
   friend auto inspect(Inspector& f, value_index& vi) {
     return f(vi.mask_, vi.none_);
@@ -67,8 +80,11 @@ private:
   virtual maybe<bitmap>
   lookup_impl(relational_operator op, data const& x) const = 0;
 
+  virtual size_t memusage_impl() const = 0;
+
   ewah_bitmap mask_;
   ewah_bitmap none_;
+  size_type pending_ = 0; // IDs covered by ::append but not yet in mask_.
 };
 
 /// An index for arithmetic values.
@@ -202,9 +218,58 @@ private:
     return visit(searcher{bmi_, op}, x);
   };
 
+  size_t memusage_impl() const override {
+    return bmi_.memusage();
+  }
+
   bitmap_index_type bmi_;
 };
 
+/// An index for timestamps that exploits the near-monotonic relationship
+/// between event IDs and event timestamps. The index keeps a sorted array of
+/// *checkpoints*, each of which records the first ID of a new timestamp bin.
+/// As long as values arrive in order, a lookup reduces to a binary search
+/// over the checkpoints that yields a contiguous ID range, without decoding
+/// any bitmaps. Values arriving out of order go into a fine-grained bitmap
+/// index underneath, which a lookup consults only if it is non-empty.
+class timestamp_index : public value_index {
+public:
+  using value_type = interval::rep;
+  using binner_type = decimal_binner<9>; // nanoseconds -> seconds
+  using bitmap_index_type =
+    bitmap_index<
+      value_type,
+      multi_level_coder<range_coder<bitmap>>,
+      binner_type
+    >;
+
+  /// Constructs a timestamp index.
+  /// @param b The base of the bitmap index for out-of-order timestamps.
+  explicit timestamp_index(base b = base::uniform<64>(10));
+
+  /// Retrieves the number of checkpoints.
+  size_t checkpoints() const;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, timestamp_index& idx) {
+    return f(static_cast<value_index&>(idx), idx.bins_, idx.firsts_,
+             idx.unsorted_, idx.bmi_);
+  }
+
+private:
+  bool push_back_impl(data const& x, size_type skip) override;
+
+  maybe<bitmap>
+  lookup_impl(relational_operator op, data const& x) const override;
+
+  size_t memusage_impl() const override;
+
+  std::vector<value_type> bins_;    // Strictly increasing bin values.
+  std::vector<event_id> firsts_;    // First ID for each entry in bins_.
+  ewah_bitmap unsorted_;            // IDs of values arriving out of order.
+  bitmap_index_type bmi_;           // Values for all IDs in unsorted_.
+};
+
 /// An index for strings.
 class string_index : public value_index {
 public:
@@ -233,6 +298,8 @@ private:
   maybe<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 
+  size_t memusage_impl() const override;
+
   size_t max_length_;
   length_bitmap_index length_;
   std::vector<char_bitmap_index> chars_;
@@ -259,6 +326,8 @@ private:
   maybe<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 
+  size_t memusage_impl() const override;
+
   std::array<byte_index, 16> bytes_;
   type_index v4_;
 };
@@ -283,6 +352,8 @@ private:
   maybe<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 
+  size_t memusage_impl() const override;
+
   address_index network_;
   prefix_index length_;
 };
@@ -317,6 +388,8 @@ private:
   maybe<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 
+  size_t memusage_impl() const override;
+
   number_index num_;
   protocol_index proto_;
 };
@@ -369,6 +442,8 @@ private:
   maybe<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 
+  size_t memusage_impl() const override;
+
   std::vector<std::unique_ptr<value_index>> elements_;
   size_bitmap_index size_;
   size_t max_size_;
@@ -415,7 +490,7 @@ struct value_index_inspect_helper {
     }
 
     result_type operator()(timestamp_type const&) const {
-      return f_(static_cast<arithmetic_index<timestamp>&>(idx_));
+      return f_(static_cast<timestamp_index&>(idx_));
     }
 
     result_type operator()(string_type const&) const {
@@ -479,7 +554,7 @@ struct value_index_inspect_helper {
     }
 
     result_type operator()(timestamp_type const&) const {
-      return std::make_unique<arithmetic_index<timestamp>>();
+      return std::make_unique<timestamp_index>();
     }
 
     result_type operator()(string_type const&) const {
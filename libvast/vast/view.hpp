@@ -0,0 +1,131 @@
+#ifndef VAST_VIEW_HPP
+#define VAST_VIEW_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "vast/aliases.hpp"
+#include "vast/address.hpp"
+#include "vast/none.hpp"
+#include "vast/operator.hpp"
+#include "vast/port.hpp"
+#include "vast/subnet.hpp"
+#include "vast/time.hpp"
+#include "vast/variant.hpp"
+#include "vast/detail/operators.hpp"
+
+namespace vast {
+
+class data;
+
+/// A non-owning reference to a contiguous sequence of characters.
+class string_view : detail::totally_ordered<string_view> {
+public:
+  using const_iterator = char const*;
+
+  /// Constructs an empty view.
+  string_view() = default;
+
+  /// Constructs a view from a pointer and a size.
+  /// @param data The beginning of the characters.
+  /// @param size The number of characters.
+  string_view(char const* data, size_t size) : data_{data}, size_{size} {
+  }
+
+  /// Constructs a view of a string.
+  /// @param str The string to reference, which must outlive the view.
+  string_view(std::string const& str) : data_{str.data()}, size_{str.size()} {
+  }
+
+  char const* data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  const_iterator begin() const {
+    return data_;
+  }
+
+  const_iterator end() const {
+    return data_ + size_;
+  }
+
+  /// Checks whether a view contains another one.
+  /// @param x The view to search for.
+  /// @returns `true` if *x* occurs in this view.
+  bool contains(string_view x) const {
+    return std::search(begin(), end(), x.begin(), x.end()) != end();
+  }
+
+  friend bool operator==(string_view x, string_view y) {
+    return x.size_ == y.size_
+      && (x.size_ == 0 || std::memcmp(x.data_, y.data_, x.size_) == 0);
+  }
+
+  // Like std::string, this compares characters as unsigned bytes.
+  friend bool operator<(string_view x, string_view y) {
+    auto n = std::min(x.size_, y.size_);
+    auto r = n == 0 ? 0 : std::char_traits<char>::compare(x.data_, y.data_, n);
+    return r < 0 || (r == 0 && x.size_ < y.size_);
+  }
+
+private:
+  char const* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+/// Creates an owning copy of a view.
+/// @relates string_view
+inline std::string to_string(string_view x) {
+  return {x.data(), x.size()};
+}
+
+/// A non-owning view of a value. Basic values are stored inline and strings
+/// reference their characters, so that neither requires a heap allocation.
+/// All other values, such as patterns and containers, are referenced as
+/// pointer to their owning data.
+using data_view = variant<
+  none,
+  boolean,
+  integer,
+  count,
+  real,
+  interval,
+  timestamp,
+  string_view,
+  address,
+  subnet,
+  port,
+  data const*
+>;
+
+/// Creates a view of a value.
+/// @param x The value to view, which must outlive the view.
+/// @returns A view of *x*.
+data_view make_view(data const& x);
+
+/// Creates an owning copy of a view.
+/// @param x The view to materialize.
+/// @returns The data referenced by *x*.
+data materialize(data_view const& x);
+
+/// Evaluates a data predicate on a view. Unlike the evaluation on
+/// materialized data, the evaluation does not allocate memory, unless it
+/// matches a string against a pattern.
+/// @param lhs The LHS of the predicate.
+/// @param op The relational operator.
+/// @param rhs The RHS of the predicate.
+/// @relates evaluate
+bool evaluate(data_view const& lhs, relational_operator op, data const& rhs);
+
+} // namespace vast
+
+#endif